@@ -0,0 +1,19 @@
+#pragma once
+
+
+namespace Cubiq {
+
+    // Totals of every allocation through the global operator new since the program started, from all threads. The
+    // counter replaces operator new and delete, so it is only linked into benchmarks
+    struct AllocationCount {
+        unsigned long allocations;
+        unsigned long bytes;
+
+        AllocationCount operator-(const AllocationCount& other) const {
+            return {allocations - other.allocations, bytes - other.bytes};
+        }
+    };
+
+    AllocationCount countAllocations();
+
+}
\ No newline at end of file
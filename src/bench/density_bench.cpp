@@ -0,0 +1,124 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+#include "bench/alloc_counter.h"
+#include "core/density.h"
+
+
+using namespace Cubiq;
+
+namespace {
+
+    const float VIEW_WIDTH = 8; // Graph units across every viewport, centered on the origin
+
+    // Normally distributed around the origin, interleaved as in a table, and the same in every run
+    std::vector<float> generatePoints(unsigned long count) {
+        std::mt19937 random(1);
+        std::normal_distribution<float> distribution(0, 1);
+        std::vector<float> points(2 * count);
+        for (float& coordinate: points) coordinate = distribution(random);
+        return points;
+    }
+
+    template<typename T>
+    bool parseList(const QString& text, std::vector<T>& values, std::function<T(const QString&, bool*)> parse) {
+        values.clear();
+        for (const QString& part: text.split(',')) {
+            bool ok;
+            values.push_back(parse(part.trimmed(), &ok));
+            if (!ok) return false;
+        }
+        return !values.empty();
+    }
+
+}
+
+
+// Measures binning point sets of every size into density images of every size, printing one JSON object per line so
+// results can be diffed between builds
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks density images of large point sets");
+    parser.addHelpOption();
+    parser.addOptions({
+            {"sizes", "Image sizes in pixels", "WxH,...", "640x360,1920x1080,2880x1620"},
+            {"points", "Numbers of points", "count,...", "1000,100000,4000000"},
+            {"min-time", "Minimum time to measure each combination for, in seconds", "seconds", "0.25"},
+    });
+    parser.process(app);
+
+    QTextStream err(stderr);
+    auto fail = [&err](const QString& message) {
+        err << message << Qt::endl;
+        return 2;
+    };
+
+    std::vector<std::pair<int, int>> sizes;
+    for (const QString& size: parser.value("sizes").split(',')) {
+        const QStringList parts = size.trimmed().split('x');
+        const int width = parts.size() == 2 ? parts[0].toInt() : 0, height = parts.size() == 2 ? parts[1].toInt() : 0;
+        if (width <= 0 || height <= 0) return fail("Invalid size: " + size);
+        sizes.emplace_back(width, height);
+    }
+
+    std::vector<unsigned long> pointCounts;
+    if (!parseList<unsigned long>(parser.value("points"), pointCounts, [](const QString& s, bool* ok) { return s.toULong(ok); })
+        || *std::min_element(pointCounts.begin(), pointCounts.end()) == 0) {
+        return fail("Invalid numbers of points: " + parser.value("points"));
+    }
+
+    bool ok;
+    const double minTime = parser.value("min-time").toDouble(&ok);
+    if (!ok || minTime < 0) return fail("Invalid minimum time: " + parser.value("min-time"));
+
+    for (unsigned long count: pointCounts) {
+        const std::vector<float> points = generatePoints(count);
+
+        for (auto [width, height]: sizes) {
+            const float viewHeight = VIEW_WIDTH * (float) height / (float) width;
+            const BoundingBox bounds{-VIEW_WIDTH / 2, VIEW_WIDTH / 2, -viewHeight / 2, viewHeight / 2};
+            std::vector<unsigned char> image;
+            SplatBuffers buffers;
+            auto splat = [&]() {
+                splatPoints(points.data(), points.data() + 1, count, 2, bounds, width, height, image, buffers);
+            };
+
+            splat(); // Warms up, so buffers kept between calls are in place as they would be when redrawing
+            const AllocationCount before = countAllocations();
+            splat();
+            const AllocationCount allocated = countAllocations() - before;
+
+            std::vector<double> times;
+            double total = 0;
+            while (times.size() < 3 || total < minTime) {
+                auto start = std::chrono::steady_clock::now();
+                splat();
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                times.push_back(elapsed.count());
+                total += elapsed.count();
+            }
+
+            std::sort(times.begin(), times.end());
+            const double median = times[times.size() / 2];
+
+            std::printf("{\"benchmark\":\"density\",\"points\":%lu,\"width\":%d,\"height\":%d,\"runs\":%zu,"
+                        "\"medianSeconds\":%.9g,\"minSeconds\":%.9g,\"pointsPerSecond\":%.6g,\"allocationsPerRun\":%lu,"
+                        "\"bytesAllocatedPerRun\":%lu}\n",
+                        count, width, height, times.size(), median, times.front(), (double) count / median,
+                        allocated.allocations, allocated.bytes);
+            std::fflush(stdout);
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
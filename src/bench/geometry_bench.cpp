@@ -0,0 +1,211 @@
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+#include "bench/alloc_counter.h"
+#include "equations/function.h"
+#include "equations/implicit_equation.h"
+#include "equations/polar.h"
+
+
+using namespace Cubiq;
+
+namespace {
+
+    const float VIEW_WIDTH = 20; // Graph units across a viewport, unless an equation is measured zoomed in
+
+    // Creates the equation to measure. Each evaluation increments the counter if one is given
+    using Factory = std::function<Equation*(unsigned long* counter)>;
+
+    struct Benchmark {
+        std::string name;
+        Factory create;
+        float centerX = 0, centerY = 0; // Center of the viewport
+        float viewWidth = VIEW_WIDTH;
+    };
+
+    Factory function(Function::IndependentVariable inVar, float (* f)(float)) {
+        return [inVar, f](unsigned long* counter) -> Equation* {
+            if (!counter) return new Function({1, 1, 1, 1}, inVar, f);
+            return new Function({1, 1, 1, 1}, inVar, [counter, f](float in) {
+                (*counter)++;
+                return f(in);
+            });
+        };
+    }
+
+    Factory implicit(float (* f)(float, float)) {
+        return [f](unsigned long* counter) -> Equation* {
+            if (!counter) return new ImplicitEquation({1, 1, 1, 1}, f);
+            return new ImplicitEquation({1, 1, 1, 1}, [counter, f](float x, float y) {
+                (*counter)++;
+                return f(x, y);
+            });
+        };
+    }
+
+    Factory polar(float (* f)(float)) {
+        return [f](unsigned long* counter) -> Equation* {
+            if (!counter) return new Polar({1, 1, 1, 1}, f);
+            return new Polar({1, 1, 1, 1}, [counter, f](float theta) {
+                (*counter)++;
+                return f(theta);
+            });
+        };
+    }
+
+    // The test equations the view was developed with, from smooth to badly behaved
+    const std::vector<Benchmark> CORPUS = {
+            {"waves", function(Function::IndependentVariable::X, [](float x) { return 2.0f * sinf(x * 3.0f) + 2.0f * cosf(x * 1.3f); })},
+            {"quartic_of_y", function(Function::IndependentVariable::Y, [](float y) { return y * y * y * y / 16 - y * y * y * 5 / 8 + y * y + y * 2; })},
+            {"tan", function(Function::IndependentVariable::X, [](float x) { return tanf(x); })},
+            {"ellipse", implicit([](float x, float y) { return x * x / 4 + y * y / 2 + (x + 2) * y / 3 - 5; })},
+            {"hyperbola", implicit([](float x, float y) { return x * y; })},
+            {"tan_of_power", implicit([](float x, float y) { return tanf(powf(x, y)) - sinf(powf(x, cosf(y))); })},
+            {"tan_of_radius", implicit([](float x, float y) { return tanf(x * x + y * y) - 1; })},
+            {"spiral", polar([](float theta) { return theta; })},
+            {"rose", polar([](float theta) { return 8.0f * cosf(theta * 7.0f / 3.0f); })},
+            // On the curve where the parameter is 20 and 1, so only a tiny part of it is visible
+            {"spiral_zoomed", polar([](float theta) { return theta; }), 8.16164f, 18.25890f, 0.05f},
+            {"rose_zoomed", polar([](float theta) { return 8.0f * cosf(theta * 7.0f / 3.0f); }), -2.98575f, -4.65002f, 0.05f},
+    };
+
+    // Calculates geometry the way a graph does before decimation, returning the number of vertices
+    unsigned long calculate(const Equation& equation, const BoundingBox& bounds, double precision) {
+        std::vector<float> vertices;
+        equation.writeSegments(vertices, bounds, precision);
+        return vertices.size() / Equation::FLOATS_PER_VERTEX;
+    }
+
+    template<typename T>
+    bool parseList(const QString& text, std::vector<T>& values, std::function<T(const QString&, bool*)> parse) {
+        values.clear();
+        for (const QString& part: text.split(',')) {
+            bool ok;
+            values.push_back(parse(part.trimmed(), &ok));
+            if (!ok) return false;
+        }
+        return !values.empty();
+    }
+
+}
+
+
+// Measures the geometry kernels of each equation in the corpus for every combination of viewport size, sample width
+// and thread count, printing one JSON object per line so results can be diffed between builds
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks the equation geometry kernels");
+    parser.addHelpOption();
+    parser.addOptions({
+            {"sizes", "Viewport sizes in pixels", "WxH,...", "640x360,1920x1080,3840x2160"},
+            {"sample-widths", "Pixels between samples", "pixels,...", "1,2,4"},
+            {"threads", "Threads per equation", "count,...", "1,2,4,8"},
+            {"min-time", "Minimum time to measure each combination for, in seconds", "seconds", "0.25"},
+            {"filter", "Only run equations whose name contains this", "text"},
+    });
+    parser.process(app);
+
+    QTextStream err(stderr);
+    auto fail = [&err](const QString& message) {
+        err << message << Qt::endl;
+        return 2;
+    };
+
+    std::vector<std::pair<int, int>> sizes;
+    for (const QString& size: parser.value("sizes").split(',')) {
+        const QStringList parts = size.trimmed().split('x');
+        const int width = parts.size() == 2 ? parts[0].toInt() : 0, height = parts.size() == 2 ? parts[1].toInt() : 0;
+        if (width <= 0 || height <= 0) return fail("Invalid size: " + size);
+        sizes.emplace_back(width, height);
+    }
+
+    std::vector<double> sampleWidths;
+    if (!parseList<double>(parser.value("sample-widths"), sampleWidths, [](const QString& s, bool* ok) { return s.toDouble(ok); })
+        || *std::min_element(sampleWidths.begin(), sampleWidths.end()) <= 0) {
+        return fail("Invalid sample widths: " + parser.value("sample-widths"));
+    }
+
+    std::vector<int> threadCounts;
+    if (!parseList<int>(parser.value("threads"), threadCounts, [](const QString& s, bool* ok) { return s.toInt(ok); })
+        || *std::min_element(threadCounts.begin(), threadCounts.end()) <= 0) {
+        return fail("Invalid thread counts: " + parser.value("threads"));
+    }
+
+    bool ok;
+    const double minTime = parser.value("min-time").toDouble(&ok);
+    if (!ok || minTime < 0) return fail("Invalid minimum time: " + parser.value("min-time"));
+    const std::string filter = parser.value("filter").toStdString();
+
+    for (const Benchmark& benchmark: CORPUS) {
+        if (benchmark.name.find(filter) == std::string::npos) continue;
+
+        std::unique_ptr<Equation> equation(benchmark.create(nullptr));
+        for (auto [width, height]: sizes) {
+            const float viewWidth = benchmark.viewWidth;
+            const float viewHeight = viewWidth * (float) height / (float) width;
+            const BoundingBox bounds{benchmark.centerX - viewWidth / 2, benchmark.centerX + viewWidth / 2,
+                                     benchmark.centerY - viewHeight / 2, benchmark.centerY + viewHeight / 2};
+            const double pixelSize = viewWidth / width;
+
+            for (double sampleWidth: sampleWidths) {
+                const double precision = sampleWidth * pixelSize;
+
+                // Evaluations do not depend on the thread count, so they are counted once on a single thread
+                unsigned long evaluations = 0;
+                {
+                    std::unique_ptr<Equation> counting(benchmark.create(&evaluations));
+                    Equation::setNumThreads(1);
+                    calculate(*counting, bounds, precision);
+                }
+
+                for (int threads: threadCounts) {
+                    Equation::setNumThreads(threads);
+                    unsigned long vertices = calculate(*equation, bounds, precision); // Also warms up
+
+                    // Counted around a single run, so the timing loop's own allocations are left out
+                    const AllocationCount before = countAllocations();
+                    calculate(*equation, bounds, precision);
+                    const AllocationCount allocated = countAllocations() - before;
+
+                    std::vector<double> times;
+                    double total = 0;
+                    while (times.size() < 3 || total < minTime) {
+                        auto start = std::chrono::steady_clock::now();
+                        vertices = calculate(*equation, bounds, precision);
+                        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                        times.push_back(elapsed.count());
+                        total += elapsed.count();
+                    }
+
+                    std::sort(times.begin(), times.end());
+                    const double median = times[times.size() / 2];
+                    const auto runs = (unsigned long) times.size();
+
+                    std::printf("{\"benchmark\":\"geometry\",\"equation\":\"%s\",\"width\":%d,\"height\":%d,"
+                                "\"sampleWidth\":%g,\"threads\":%d,\"runs\":%lu,\"medianSeconds\":%.9g,"
+                                "\"minSeconds\":%.9g,\"evaluations\":%lu,\"evaluationsPerSecond\":%.6g,"
+                                "\"vertices\":%lu,\"verticesPerSecond\":%.6g,\"allocationsPerRun\":%lu,"
+                                "\"bytesAllocatedPerRun\":%lu}\n",
+                                benchmark.name.c_str(), width, height, sampleWidth, threads, runs, median, times.front(),
+                                evaluations, (double) evaluations / median, vertices, (double) vertices / median,
+                                allocated.allocations, allocated.bytes);
+                    std::fflush(stdout);
+                }
+            }
+        }
+    }
+
+    Equation::setNumThreads(Equation::DEFAULT_NUM_THREADS);
+    return 0;
+}
\ No newline at end of file
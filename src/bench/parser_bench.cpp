@@ -0,0 +1,185 @@
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+#include "bench/alloc_counter.h"
+#include "parser/interpreter.h"
+#include "equations/equation_parser.h"
+
+
+using namespace Cubiq;
+
+namespace {
+
+    // Creates an input of the given size, in units that depend on the input
+    using Generator = std::function<std::string(int size)>;
+
+    struct Input {
+        std::string name;
+        Generator generate;
+        int size;    // Representative size
+        int maxSize; // Largest size when scaling, where recursion depth would otherwise run out of stack
+    };
+
+    // y = 1.5x^{n} + 2.5x^{n-1} + ... with one term per unit
+    std::string polynomial(int terms) {
+        std::string source = "y=";
+        for (int i = terms; i > 0; i--) {
+            source += std::to_string(i) + ".5x^{" + std::to_string(i) + "}";
+            if (i > 1) source += "+";
+        }
+        return source;
+    }
+
+    // Fractions and roots alternately nested inside each other, one per unit
+    std::string nested(int depth) {
+        std::string source = "x";
+        for (int i = 0; i < depth; i++) {
+            source = i % 2 == 0 ? "\\frac{1}{" + source + "+2}" : "\\sqrt{" + source + "+1}";
+        }
+        return "y=" + source;
+    }
+
+    // \left[...\right] with one number per unit
+    std::string array(int items) {
+        std::string source = "\\left[";
+        for (int i = 0; i < items; i++) {
+            if (i > 0) source += ",";
+            source += std::to_string(i) + "." + std::to_string(i % 997);
+        }
+        return source + "\\right]";
+    }
+
+    const std::vector<Input> INPUTS = {
+            {"polynomial", polynomial, 64, 1 << 20},
+            {"nested", nested, 32, 2048},
+            {"array", array, 1024, 1 << 20},
+    };
+
+
+    Parser::CharStream streamOf(const std::string& source, std::string::size_type& pos) {
+        pos = 0;
+        return [&source, &pos]() -> int {
+            return pos < source.size() ? (unsigned char) source[pos++] : -1;
+        };
+    }
+
+    unsigned long tokenize(const std::string& source) {
+        std::string::size_type pos;
+        Parser::CharStream stream = streamOf(source, pos);
+        unsigned long tokens = 0;
+        for (Parser::TokenIterator it(stream); it; ++it) tokens++;
+        return tokens;
+    }
+
+    void parse(const std::string& source) {
+        std::string::size_type pos;
+        Parser::CharStream stream = streamOf(source, pos);
+        Parser::GraphContext context;
+        Parser::TokenIterator it(stream);
+        Parser::generateParseTree(context, it, Parser::DataType::NOTHING, false);
+    }
+
+    // Median time of running f repeatedly for at least the given time, and at least 3 times
+    double measure(double minTime, unsigned long& runs, const std::function<void()>& f) {
+        std::vector<double> times;
+        double total = 0;
+        while (times.size() < 3 || total < minTime) {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            times.push_back(elapsed.count());
+            total += elapsed.count();
+        }
+        runs = times.size();
+        std::nth_element(times.begin(), times.begin() + (long) times.size() / 2, times.end());
+        return times[times.size() / 2];
+    }
+
+}
+
+
+// Measures the tokenizer and the interpreter on generated inputs, printing one JSON object per line so results can be
+// diffed between builds. In scaling mode each input is doubled in size until it reaches the byte limit, and the
+// exponent of parse time against size between steps shows any superlinear behavior
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks the LaTeX tokenizer and parser");
+    parser.addHelpOption();
+    parser.addOptions({
+            {"scale", "Double each input in size up to the byte limit instead of using representative sizes"},
+            {"max-kb", "Largest input when scaling, in kilobytes", "kilobytes", "64"},
+            {"min-time", "Minimum time to measure each input for, in seconds", "seconds", "0.25"},
+            {"filter", "Only run inputs whose name contains this", "text"},
+    });
+    parser.process(app);
+
+    QTextStream err(stderr);
+    auto fail = [&err](const QString& message) {
+        err << message << Qt::endl;
+        return 2;
+    };
+
+    bool ok;
+    const double minTime = parser.value("min-time").toDouble(&ok);
+    if (!ok || minTime < 0) return fail("Invalid minimum time: " + parser.value("min-time"));
+    const double maxKB = parser.value("max-kb").toDouble(&ok);
+    if (!ok || maxKB <= 0) return fail("Invalid byte limit: " + parser.value("max-kb"));
+    const bool scale = parser.isSet("scale");
+    const std::string filter = parser.value("filter").toStdString();
+
+    for (const Input& input: INPUTS) {
+        if (input.name.find(filter) == std::string::npos) continue;
+
+        double previousBytes = 0, previousSeconds = 0;
+        for (int size = scale ? 1 : input.size; size <= input.maxSize; size *= 2) {
+            const std::string source = input.generate(size);
+            if (scale && (double) source.size() > maxKB * 1024) break;
+
+            try {
+                parse(source);
+            } catch (const Parser::Error& error) {
+                return fail(QString::fromStdString(input.name + ": " + describeError(error)));
+            }
+
+            unsigned long tokenizeRuns, parseRuns, tokens = tokenize(source);
+            const double tokenizeSeconds = measure(minTime, tokenizeRuns, [&source]() { tokenize(source); });
+
+            // Counted around a single parse, so the timing loop's own allocations are left out
+            const AllocationCount before = countAllocations();
+            parse(source);
+            const AllocationCount allocated = countAllocations() - before;
+            const double parseSeconds = measure(minTime, parseRuns, [&source]() { parse(source); });
+
+            const double bytes = (double) source.size();
+            std::string exponent = "null";
+            if (previousBytes > 0) {
+                exponent = std::to_string(std::log(parseSeconds / previousSeconds) / std::log(bytes / previousBytes));
+            }
+            previousBytes = bytes;
+            previousSeconds = parseSeconds;
+
+            std::printf("{\"benchmark\":\"parser\",\"input\":\"%s\",\"size\":%d,\"bytes\":%zu,\"tokens\":%lu,"
+                        "\"tokenizeSeconds\":%.9g,\"tokensPerSecond\":%.6g,\"parseRuns\":%lu,\"parseSeconds\":%.9g,"
+                        "\"parseMicrosPerKB\":%.6g,\"allocationsPerParse\":%lu,\"bytesAllocatedPerParse\":%lu,"
+                        "\"scalingExponent\":%s}\n",
+                        input.name.c_str(), size, source.size(), tokens, tokenizeSeconds,
+                        (double) tokens / tokenizeSeconds, parseRuns, parseSeconds, parseSeconds * 1e6 / (bytes / 1024),
+                        allocated.allocations, allocated.bytes, exponent.c_str());
+            std::fflush(stdout);
+
+            if (!scale) break;
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -16,6 +16,20 @@ namespace Cubiq {
             return {minX + dx, maxX + dx, minY + dy, maxY + dy};
         }
 
+        [[nodiscard]] BoundingBox scaled(float factor) const {
+            float dx = 0.5f * factor * width(), dy = 0.5f * factor * height();
+            return {centerX() - dx, centerX() + dx, centerY() - dy, centerY() + dy};
+        }
+
+        // Keeps the width, and fits the height around the center to the given height-to-width ratio of the screen
+        [[nodiscard]] BoundingBox withAspect(float aspect) const {
+            return {minX, maxX, centerY() - 0.5f * height() * aspect, centerY() + 0.5f * height() * aspect};
+        }
+
+        [[nodiscard]] bool contains(const BoundingBox& bb) const {
+            return bb.minX >= minX && bb.maxX <= maxX && bb.minY >= minY && bb.maxY <= maxY;
+        }
+
     };
 
 }
\ No newline at end of file
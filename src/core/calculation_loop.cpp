@@ -0,0 +1,109 @@
+#include "calculation_loop.h"
+
+#include <chrono>
+#include <utility>
+#include <omp.h>
+
+#include "core/trace.h"
+
+
+namespace Cubiq {
+
+    const int CalculationLoop::MILLIS_PER_UPDATE = 17;
+    const int CalculationLoop::IDLE_MILLIS = 250; // Time without updates before full quality is restored
+
+    namespace {
+
+        long long steadyMillis() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+    }
+
+
+    CalculationLoop::CalculationLoop(Graph* g, double minSampleWidth, double frameBudget, View view,
+                                     std::function<void()> calculated) :
+            graph(g),
+            view(std::move(view)),
+            calculated(std::move(calculated)),
+            toExit(false),
+            lastUpdateRequest(0),
+            calculatedRequest(0),
+            requestSerial(0),
+            handledSerial(0),
+            governor(minSampleWidth, frameBudget),
+            staleQuality(false),
+            thread(&CalculationLoop::run, this) {}
+
+    CalculationLoop::~CalculationLoop() {
+        stop();
+    }
+
+    void CalculationLoop::run() {
+        // Equations are calculated in parallel, and may use threads of their own
+        omp_set_max_active_levels(2);
+        Trace::nameThread("Calculation");
+
+        while (!toExit) {
+            {
+                std::scoped_lock<std::mutex> lock(graphMutex);
+                // Quality may only be reduced while the view keeps changing, and is restored once it settles
+                const bool interactive = steadyMillis() - lastUpdateRequest < IDLE_MILLIS;
+                const bool restoreQuality = staleQuality && !interactive;
+
+                // The serial is read before the view, and requests bump it after changing the view, so the view read
+                // is at least as recent as every request up to the serial
+                const unsigned long serial = requestSerial;
+                BoundingBox visible{};
+                double pixelSize;
+                if (view(*graph, visible, pixelSize)) {
+                    // Changes to the graph itself, e.g. equations finishing loading, need no request
+                    if (serial != handledSerial || restoreQuality || graph->isOutdated()) {
+                        TraceSpan span("CalculationLoop::update");
+                        // Panning within the overscanned region only needs a new projection
+                        if (restoreQuality || graph->isCalculationNeeded(visible, pixelSize)) {
+                            const long long request = lastUpdateRequest;
+                            graph->calculateVertices(visible.scaled(Graph::OVERSCAN), pixelSize, governor, interactive);
+                            calculatedRequest = request;
+                            staleQuality = interactive && governor.isReduced();
+                            calculated();
+                        }
+                    }
+                    handledSerial = serial;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(MILLIS_PER_UPDATE));
+        }
+    }
+
+    // The serial is the request itself: the loop calculates whenever it has moved on since the last pass
+    unsigned long CalculationLoop::markToUpdate() {
+        lastUpdateRequest = steadyMillis();
+        return ++requestSerial;
+    }
+
+    void CalculationLoop::stop() {
+        toExit = true;
+        if (thread.joinable()) thread.join();
+    }
+
+    void CalculationLoop::setGraph(Graph* g) {
+        std::scoped_lock<std::mutex> lock(graphMutex);
+        graph = g;
+    }
+
+    void CalculationLoop::setQuality(double minSampleWidth, double frameBudget) {
+        std::scoped_lock<std::mutex> lock(graphMutex);
+        governor.configure(minSampleWidth, frameBudget);
+        staleQuality = true;
+    }
+
+    long long CalculationLoop::getCalculatedRequest() const {
+        return calculatedRequest;
+    }
+
+    unsigned long CalculationLoop::getHandledSerial() const {
+        return handledSerial;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+
+#include "core/graph.h"
+#include "core/bounding_box.h"
+#include "core/quality_governor.h"
+
+
+namespace Cubiq {
+
+    // Keeps a graph's geometry following its view on a thread of its own. Rather than queueing view changes, the
+    // thread polls for the latest one, and only recalculates once the current geometry no longer covers it. Quality
+    // may be reduced while the view keeps changing, and is restored once it settles
+    class CalculationLoop {
+
+    public:
+        static const int MILLIS_PER_UPDATE;
+        static const int IDLE_MILLIS;
+
+        // Region of the graph on screen and the size of its pixels, or false while there is no screen to cover yet
+        using View = std::function<bool(Graph& graph, BoundingBox& visible, double& pixelSize)>;
+
+        // calculated is called on the loop's thread whenever new geometry is ready to be drawn
+        CalculationLoop(Graph* g, double minSampleWidth, double frameBudget, View view, std::function<void()> calculated);
+        ~CalculationLoop();
+
+        unsigned long markToUpdate(); // Returns the serial number of the request
+        void stop(); // Waits for any calculation in progress to finish
+
+        void setGraph(Graph* g);
+        void setQuality(double minSampleWidth, double frameBudget);
+
+        // When the view change behind the current geometry was requested, in steady milliseconds
+        long long getCalculatedRequest() const;
+        // Latest request whose view the current geometry covers, whether or not it needed calculating
+        unsigned long getHandledSerial() const;
+
+    private:
+        void run();
+
+        std::mutex graphMutex;
+        Graph* graph;
+        View view;
+        std::function<void()> calculated;
+
+        std::atomic<bool> toExit;
+        std::atomic<long long> lastUpdateRequest;
+        std::atomic<long long> calculatedRequest;
+        std::atomic<unsigned long> requestSerial;
+        std::atomic<unsigned long> handledSerial;
+
+        QualityGovernor governor;
+        bool staleQuality; // Whether the current geometry is coarser than the configured quality
+
+        std::thread thread; // Last, so it only starts once every other member is initialized
+
+    };
+
+}
\ No newline at end of file
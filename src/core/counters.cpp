@@ -0,0 +1,11 @@
+#include "counters.h"
+
+
+namespace Cubiq {
+
+    std::atomic<unsigned long> Counters::evaluations = 0;
+    std::atomic<unsigned long> Counters::equationsCalculated = 0;
+    std::atomic<unsigned long> Counters::busyMicros = 0;
+    std::atomic<unsigned long> Counters::capacityMicros = 0;
+
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <atomic>
+
+
+namespace Cubiq {
+
+    // Totals of the work done by the engine since the program started, sampled by the performance overlay. Kernels add
+    // to them once per call rather than per evaluation, with relaxed increments, so counting costs next to nothing
+    class Counters {
+
+    public:
+        static std::atomic<unsigned long> evaluations;
+        static std::atomic<unsigned long> equationsCalculated;
+
+        // Thread utilization of graph calculations: time spent calculating equations, summed over threads, against
+        // the wall time of each calculation times the threads it had available
+        static std::atomic<unsigned long> busyMicros;
+        static std::atomic<unsigned long> capacityMicros;
+
+    };
+
+}
\ No newline at end of file
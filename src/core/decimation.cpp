@@ -0,0 +1,111 @@
+#include "decimation.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+namespace Cubiq {
+
+    namespace {
+
+        struct Point {
+            float x, y;
+
+            bool operator==(const Point& p) const { return x == p.x && y == p.y; }
+        };
+
+
+        class SegmentWriter {
+
+        public:
+            explicit SegmentWriter(std::vector<float>& out) : output(out), previous{}, hasPrevious(false) {}
+
+            // Continues the current polyline to the given point
+            void lineTo(const Point& p) {
+                if (hasPrevious && !(p == previous)) {
+                    output.insert(output.end(), {previous.x, previous.y, p.x, p.y});
+                }
+                previous = p;
+                hasPrevious = true;
+            }
+
+            void endLine() {
+                hasPrevious = false;
+            }
+
+        private:
+            std::vector<float>& output;
+            Point previous;
+            bool hasPrevious;
+
+        };
+
+
+        // Emits the extrema of one pixel column run, [first, last] of the polyline, in their original order
+        void flushRun(const std::vector<Point>& line, size_t first, size_t last, SegmentWriter& writer) {
+            size_t low = first, high = first;
+            for (size_t i = first + 1; i <= last; i++) {
+                if (line[i].y < line[low].y) low = i;
+                if (line[i].y > line[high].y) high = i;
+            }
+
+            size_t keep[] = {first, std::min(low, high), std::max(low, high), last};
+            for (size_t i : keep) {
+                writer.lineTo(line[i]);
+            }
+        }
+
+
+        void decimatePolyline(const std::vector<Point>& line, double pixelWidth, SegmentWriter& writer) {
+            if (pixelWidth <= 0) {
+                for (const Point& p : line) writer.lineTo(p);
+                writer.endLine();
+                return;
+            }
+
+            size_t runStart = 0;
+            double runColumn = std::floor(line[0].x / pixelWidth);
+
+            for (size_t i = 1; i < line.size(); i++) {
+                double column = std::floor(line[i].x / pixelWidth);
+                if (column != runColumn) {
+                    flushRun(line, runStart, i - 1, writer);
+                    runStart = i;
+                    runColumn = column;
+                }
+            }
+            flushRun(line, runStart, line.size() - 1, writer);
+            writer.endLine();
+        }
+
+    }
+
+
+    void decimateSegments(std::vector<float>& vertices, double pixelWidth) {
+        std::vector<float> output;
+        output.reserve(vertices.size());
+        SegmentWriter writer(output);
+
+        std::vector<Point> line;
+        const size_t numSegments = vertices.size() / 4;
+
+        for (size_t i = 0; i < numSegments; i++) {
+            Point start{vertices[4 * i], vertices[4 * i + 1]};
+            Point end{vertices[4 * i + 2], vertices[4 * i + 3]};
+
+            if (start == end) continue;
+
+            // Segments sharing an endpoint with the previous one extend the current polyline
+            if (line.empty() || !(line.back() == start)) {
+                if (!line.empty()) decimatePolyline(line, pixelWidth, writer);
+                line.clear();
+                line.push_back(start);
+            }
+            line.push_back(end);
+        }
+        if (!line.empty()) decimatePolyline(line, pixelWidth, writer);
+
+        vertices.swap(output);
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+
+namespace Cubiq {
+
+    // Reduces line segment geometry (pairs of (x, y) vertices) to roughly what can be seen at the given pixel width.
+    // Connected segments are joined into polylines, and each run of points falling into the same pixel column is
+    // collapsed to its first, lowest, highest and last point. This keeps every spike within a column while bounding the
+    // output by the screen resolution rather than by the sample count. Degenerate segments are dropped entirely.
+    // A pixel width of 0 only drops degenerate segments.
+    void decimateSegments(std::vector<float>& vertices, double pixelWidth);
+
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "density.h"
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <omp.h>
+
+#include "equations/equation.h"
+
+
+namespace Cubiq {
+
+    static const int BAND_ROWS = 16; // Rows of the histogram in a band, which a single thread bins into
+    static const unsigned long CHUNK_POINTS = 1ul << 20; // Points sorted into bands at a time
+
+    void splatPoints(const float* xs, const float* ys, unsigned long count, int stride, BoundingBox region, int width,
+                     int height, std::vector<unsigned char>& image, SplatBuffers& buffers) {
+        const unsigned long numPixels = (unsigned long) width * height;
+        image.assign(numPixels, 0);
+        if (numPixels == 0 || count == 0) return;
+
+        const float scaleX = (float) width / region.width();
+        const float scaleY = (float) height / region.height();
+        const int numBands = (height + BAND_ROWS - 1) / BAND_ROWS;
+        const unsigned long bandPixels = (unsigned long) BAND_ROWS * width;
+        const int numThreads = Equation::getNumThreads();
+
+        std::vector<uint32_t>& histogram = buffers.histogram;
+        std::vector<uint32_t>& pixels = buffers.pixels;
+        std::vector<unsigned long>& ends = buffers.ends;
+        std::vector<char>& touched = buffers.touched;
+        if (histogram.size() != numPixels) histogram = std::vector<uint32_t>(numPixels); // Frees a larger one
+        pixels.resize(std::min(count, CHUNK_POINTS));
+        touched.assign(numBands, false);
+
+        // Pixel of a point, or numPixels if it is outside the region. NaN coordinates fail every comparison
+        auto locate = [&](unsigned long i) {
+            const float px = (xs[i * stride] - region.minX) * scaleX;
+            const float py = (ys[i * stride] - region.minY) * scaleY;
+            if (!(px >= 0 && px < (float) width && py >= 0 && py < (float) height)) return numPixels;
+            return (unsigned long) py * width + (unsigned long) px;
+        };
+
+        // Each chunk of points is counted and sorted into bands, then every band is binned by one thread, so threads
+        // never write to the same part of the histogram. Only bands with points in them are visited afterwards, so the
+        // cost follows the points rather than the size of the image
+        for (unsigned long first = 0; first < count; first += CHUNK_POINTS) {
+            const auto chunk = (long) std::min(CHUNK_POINTS, count - first);
+            ends.assign((unsigned long) numBands * numThreads, 0);
+
+            #pragma omp parallel num_threads(numThreads) shared(histogram, pixels, ends, touched, locate, first, chunk, numThreads, numBands, numPixels, bandPixels) default(none)
+            {
+                const int thread = omp_get_thread_num();
+
+                #pragma omp for schedule(static)
+                for (long i = 0; i < chunk; i++) {
+                    const unsigned long pixel = locate(first + i);
+                    if (pixel < numPixels) ends[pixel / bandPixels * numThreads + thread]++;
+                }
+
+                #pragma omp single
+                {
+                    unsigned long total = 0;
+                    for (unsigned long& end: ends) {
+                        const unsigned long n = end;
+                        end = total;
+                        total += n;
+                    }
+                }
+
+                // The same static schedule gives every thread the same points as when counting
+                #pragma omp for schedule(static)
+                for (long i = 0; i < chunk; i++) {
+                    const unsigned long pixel = locate(first + i);
+                    if (pixel < numPixels) pixels[ends[pixel / bandPixels * numThreads + thread]++] = (uint32_t) pixel;
+                }
+
+                #pragma omp for schedule(dynamic)
+                for (int band = 0; band < numBands; band++) {
+                    const unsigned long begin = band == 0 ? 0 : ends[(unsigned long) band * numThreads - 1];
+                    const unsigned long end = ends[(unsigned long) (band + 1) * numThreads - 1];
+                    for (unsigned long i = begin; i < end; i++) histogram[pixels[i]]++;
+                    if (end > begin) touched[band] = true;
+                }
+            }
+        }
+
+        uint32_t maxCount = 0;
+        #pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(histogram, touched, numBands, numPixels, bandPixels) reduction(max: maxCount) default(none)
+        for (int band = 0; band < numBands; band++) {
+            if (!touched[band]) continue;
+            const unsigned long end = std::min(numPixels, (band + 1) * bandPixels);
+            for (unsigned long i = band * bandPixels; i < end; i++) maxCount = std::max(maxCount, histogram[i]);
+        }
+
+        // Logarithmic tone mapping, with every non-empty pixel at least faintly visible. The histogram is cleared on
+        // the way, ready for the next call
+        const float scale = 255.0f / std::log1p((float) std::max(maxCount, 1u));
+        #pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(image, histogram, touched, numBands, numPixels, bandPixels, scale) default(none)
+        for (int band = 0; band < numBands; band++) {
+            if (!touched[band]) continue;
+            const unsigned long end = std::min(numPixels, (band + 1) * bandPixels);
+            for (unsigned long i = band * bandPixels; i < end; i++) {
+                if (histogram[i] == 0) continue;
+                image[i] = (unsigned char) std::max(1.0f, std::log1p((float) histogram[i]) * scale);
+                histogram[i] = 0;
+            }
+        }
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "core/bounding_box.h"
+
+
+namespace Cubiq {
+
+    // Working memory of splatPoints, owned by the caller and kept between calls so redrawing does not allocate it
+    // again. A set of buffers is used by one call at a time
+    struct SplatBuffers {
+        std::vector<uint32_t> histogram; // All zero between calls
+        std::vector<uint32_t> pixels; // Pixel index of each point of a chunk, grouped by band
+        std::vector<unsigned long> ends; // End of each thread's points in each band, once grouped
+        std::vector<char> touched; // Whether any point fell in each band
+    };
+
+    // Renders a point set too large to draw point by point as a density image covering the region, with row 0 at
+    // minY. Points are sorted into bands of rows, and each band is binned by a single thread, so no synchronization is
+    // needed per point and the cost follows the number of points rather than the size of the image. Counts are
+    // tone-mapped logarithmically to 8-bit coverage, which keeps single points visible next to areas with millions.
+    // The x and y of point i are xs[i * stride] and ys[i * stride]
+    void splatPoints(const float* xs, const float* ys, unsigned long count, int stride, BoundingBox region, int width,
+                     int height, std::vector<unsigned char>& image, SplatBuffers& buffers);
+
+}
\ No newline at end of file
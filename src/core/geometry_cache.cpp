@@ -0,0 +1,135 @@
+#include "geometry_cache.h"
+
+#include <cstring>
+#include <QSaveFile>
+
+
+namespace Cubiq {
+
+    const char GeometryCache::MAGIC[8] = {'C', 'U', 'B', 'I', 'Q', 'G', 'E', 'O'};
+    const quint32 GeometryCache::VERSION = 1;
+
+    // Layout: FileHeader, then one EntryRecord per element, then the vertex data each record points to
+    struct GeometryCache::FileHeader {
+        char magic[8];
+        quint32 version;
+        quint32 numEntries;
+    };
+
+    struct GeometryCache::EntryRecord {
+        quint64 key;
+        quint32 index;
+        quint32 reserved;
+        float bounds[4]; // minX, maxX, minY, maxY
+        double precision;
+        quint64 offset; // Bytes from the start of the file
+        quint64 numFloats;
+    };
+
+
+    QString GeometryCache::pathFor(const QString& graphPath) {
+        return graphPath + ".geometry";
+    }
+
+    // 64-bit FNV-1a
+    quint64 GeometryCache::hash(const std::string& type, const std::string& source, const BoundingBox& bounds, double precision) {
+        quint64 h = 14695981039346656037ull;
+        auto add = [&h](const void* bytes, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                h ^= ((const uchar*) bytes)[i];
+                h *= 1099511628211ull;
+            }
+        };
+        add(type.data(), type.size() + 1);
+        add(source.data(), source.size() + 1);
+        add(&bounds, sizeof(bounds));
+        add(&precision, sizeof(precision));
+        return h;
+    }
+
+
+    GeometryCache::GeometryCache(const QString& path) : file(path), data(nullptr) {}
+
+    GeometryCache::~GeometryCache() {
+        if (data) file.unmap(const_cast<uchar*>(data));
+    }
+
+    std::shared_ptr<GeometryCache> GeometryCache::open(const QString& path) {
+        static_assert(sizeof(FileHeader) == 16 && sizeof(EntryRecord) == 56, "Cache layout must not depend on padding");
+
+        std::shared_ptr<GeometryCache> cache(new GeometryCache(path));
+        if (!cache->file.open(QIODevice::ReadOnly)) return nullptr;
+
+        const qint64 size = cache->file.size();
+        if (size < (qint64) sizeof(FileHeader)) return nullptr;
+        cache->data = cache->file.map(0, size);
+        if (!cache->data) return nullptr;
+
+        // The mapping is page aligned, and every structure in the file is at a multiple of its alignment
+        const auto* header = (const FileHeader*) cache->data;
+        if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION) return nullptr;
+        if (sizeof(FileHeader) + (quint64) header->numEntries * sizeof(EntryRecord) > (quint64) size) return nullptr;
+
+        const auto* records = (const EntryRecord*) (cache->data + sizeof(FileHeader));
+        for (quint32 i = 0; i < header->numEntries; i++) {
+            const EntryRecord& record = records[i];
+            if (record.offset % sizeof(float) != 0 || record.offset > (quint64) size) return nullptr;
+            if (record.numFloats > ((quint64) size - record.offset) / sizeof(float)) return nullptr;
+            cache->entries[record.index] = &record;
+        }
+
+        return cache;
+    }
+
+    bool GeometryCache::write(const QString& path, const std::vector<Entry>& entries) {
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) return false;
+
+        FileHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.numEntries = (quint32) entries.size();
+        file.write((const char*) &header, sizeof(header));
+
+        quint64 offset = sizeof(FileHeader) + entries.size() * sizeof(EntryRecord);
+        for (const Entry& entry: entries) {
+            EntryRecord record{};
+            record.key = hash(entry.type, entry.source, entry.bounds, entry.precision);
+            record.index = entry.index;
+            record.bounds[0] = entry.bounds.minX;
+            record.bounds[1] = entry.bounds.maxX;
+            record.bounds[2] = entry.bounds.minY;
+            record.bounds[3] = entry.bounds.maxY;
+            record.precision = entry.precision;
+            record.offset = offset;
+            record.numFloats = entry.vertices.size();
+            file.write((const char*) &record, sizeof(record));
+            offset += entry.vertices.size() * sizeof(float);
+        }
+
+        for (const Entry& entry: entries) {
+            file.write((const char*) entry.vertices.data(), (qint64) (entry.vertices.size() * sizeof(float)));
+        }
+
+        return file.commit();
+    }
+
+
+    bool GeometryCache::find(quint32 index, const std::string& type, const std::string& source, Graph::Snapshot& snapshot) const {
+        auto it = entries.find(index);
+        if (it == entries.end()) return false;
+
+        const EntryRecord& record = *it->second;
+        BoundingBox bounds{record.bounds[0], record.bounds[1], record.bounds[2], record.bounds[3]};
+        if (hash(type, source, bounds, record.precision) != record.key) return false;
+
+        snapshot.vertices.clear();
+        snapshot.bounds = bounds;
+        snapshot.precision = record.precision;
+        snapshot.cache = shared_from_this();
+        snapshot.mappedVertices = (const float*) (data + record.offset);
+        snapshot.numMappedFloats = record.numFloats;
+        return true;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <QFile>
+#include <QString>
+
+#include "core/graph.h"
+
+
+namespace Cubiq {
+
+    // Calculated geometry stored next to a graph file, so a graph can be drawn as soon as it is opened. The file is
+    // memory-mapped and its vertices are handed to the draw path without being copied. Each entry is keyed by a hash
+    // of the element's type and source, along with the bounds and sample width stored with it, so geometry is never
+    // used for an element whose source has changed. It is used whatever view the graph opens at: a snapshot carries
+    // its bounds, so it is drawn where it was calculated until the view calculates its own. Entries are in native byte
+    // order; a cache written on another platform is simply rejected
+    class GeometryCache : public std::enable_shared_from_this<GeometryCache> {
+
+    public:
+        static const char MAGIC[8];
+        static const quint32 VERSION;
+
+        // Geometry of one graph element, as written to a cache
+        struct Entry {
+            quint32 index; // Position of the element in the graph file
+            std::string type, source;
+            BoundingBox bounds;
+            double precision;
+            std::vector<float> vertices;
+        };
+
+        static QString pathFor(const QString& graphPath);
+        static quint64 hash(const std::string& type, const std::string& source, const BoundingBox& bounds, double precision);
+
+        // Maps and validates a cache file, returning nullptr if it is missing or invalid
+        static std::shared_ptr<GeometryCache> open(const QString& path);
+        static bool write(const QString& path, const std::vector<Entry>& entries);
+
+        // Fills in the snapshot for an element if the cache has geometry for its current type and source, whatever
+        // bounds and sample width it was calculated for
+        bool find(quint32 index, const std::string& type, const std::string& source, Graph::Snapshot& snapshot) const;
+
+        ~GeometryCache();
+
+    private:
+        struct FileHeader;
+        struct EntryRecord;
+
+        QFile file;
+        const uchar* data;
+        std::unordered_map<quint32, const EntryRecord*> entries;
+
+        explicit GeometryCache(const QString& path);
+
+    };
+
+}
\ No newline at end of file
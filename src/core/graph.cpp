@@ -1,27 +1,31 @@
 #include "graph.h"
+#include "trace.h"
+#include "counters.h"
 
-#include <cstring>
 #include <utility>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
 
 
 namespace Cubiq {
 
     const int Graph::NUM_THREADS = 2; // Number of threads to use for parallel computing
-
-    Graph::Graph(BoundingBox bb) : boundingBox(bb), equationList(), name("Untitled Graph") {
-        numVertices = 0;
-        vertices = nullptr;
+    const float Graph::OVERSCAN = 1.5f; // Size of the calculated region relative to the visible area
+    const float Graph::EDGE_MARGIN = 1.1f; // Recalculate once this much of the visible area is no longer covered
+    const double Graph::ZOOM_TOLERANCE = 1.5; // Recalculate once the zoom level is off by this factor
+
+    Graph::Graph(BoundingBox bb) : boundingBox(bb), equationList(), name("Untitled Graph"), calculatedBounds(bb) {
+        grid = true;
+        revision = 0;
+        calculatedPixelSize = 0;
+        outdated = true;
+        pixelShading = false;
     }
 
     Graph::Graph() : Graph(BoundingBox{-10, 10, -10, 10}) {}
 
-    Graph::~Graph() {
-        std::scoped_lock<std::mutex> lock(mutex);
-        for (Equation* e: equationList) {
-            delete e;
-        }
-        delete[] vertices;
-    }
+    Graph::~Graph() = default;
 
 
     QString Graph::getName() const {
@@ -59,53 +63,203 @@ namespace Cubiq {
     }
 
 
-    // Returns a copy of the internal vertex list
-    GLfloat* Graph::getVertices(unsigned long& numVerts) {
-        std::scoped_lock<std::mutex> lock(mutex);
+    // Returns the equations of this graph. Use with a mutex lock
+    const std::vector<std::shared_ptr<Equation>>& Graph::getEquations() const {
+        return equationList;
+    }
+
+    // Returns the geometry of each equation, in order. Use with a mutex lock
+    const std::vector<Graph::Snapshot>& Graph::getSnapshots() const {
+        return snapshots;
+    }
 
-        numVerts = numVertices;
-        if (numVertices == 0) { return nullptr; }
 
-        auto* verts = new GLfloat[numVertices * 7];
-        std::memcpy(verts, vertices, numVertices * 7 * sizeof(GLfloat));
-        return verts;
+    void Graph::calculateVertices(double precision) {
+        calculateVertices(getBoundingBox(), precision);
     }
 
-    // Returns the internal vertex list. Use with a mutex lock
-    GLfloat* Graph::getVertexList(unsigned long& numVerts) {
-        numVerts = numVertices;
-        return vertices;
+    // Calculates the geometry for an arbitrary region, usually larger than the bounding box so it can be panned.
+    // If a pixel size is given, geometry finer than a pixel is decimated before it is stored
+    void Graph::calculateVertices(BoundingBox region, double precision, double pixelSize) {
+        calculateSnapshots(region, precision, pixelSize, nullptr, false);
     }
 
+    // Same as above, but with the sample width of each equation chosen by the governor, which is then told how long
+    // each equation took
+    void Graph::calculateVertices(BoundingBox region, double pixelSize, QualityGovernor& governor, bool interactive) {
+        calculateSnapshots(region, 0, pixelSize, &governor, interactive);
+    }
 
-    void Graph::calculateVertices(double precision) {
-        std::scoped_lock<std::mutex> lock(mutex);
+    // Calculates the geometry for an image of width × height pixels showing exactly the viewport, with samples the
+    // given number of pixels apart. This needs no view, so it is the entry point for using graphs outside the UI
+    void Graph::calculateViewport(BoundingBox viewport, int width, int height, double sampleWidth) {
+        const double pixelSize = std::max(viewport.width() / width, viewport.height() / height);
+        calculateSnapshots(viewport, sampleWidth * pixelSize, pixelSize, nullptr, false);
+    }
+
+    // Same as above, but returns the geometry instead of storing it. The graph is left as it is, so any number of
+    // threads can compute different viewports of the same graph at once, e.g. to serve tiles
+    std::vector<Graph::Snapshot> Graph::computeViewport(BoundingBox viewport, int width, int height, double sampleWidth) {
+        std::vector<std::shared_ptr<Equation>> equations;
+        {
+            std::scoped_lock<std::mutex> lock(mutex);
+            equations = equationList;
+        }
+
+        const double pixelSize = std::max(viewport.width() / width, viewport.height() / height);
+        std::vector<Snapshot> result(equations.size());
+        for (int i = 0; i < equations.size(); i++) {
+            if (equations.at(i)->isPending()) continue;
+            calculateSnapshot(*equations.at(i), result.at(i), viewport, sampleWidth * pixelSize, pixelSize);
+        }
+        return result;
+    }
+
+    // The mutex is only held to swap in the results, so the previous snapshots stay drawable meanwhile
+    void Graph::calculateSnapshots(BoundingBox region, double precision, double pixelSize, QualityGovernor* governor, bool interactive) {
+        TraceSpan span("Graph::calculateVertices");
+
+        std::vector<std::shared_ptr<Equation>> equations;
+        std::vector<char> shaded;
+        unsigned long newRevision;
+        {
+            std::scoped_lock<std::mutex> lock(mutex);
+            equations = equationList;
+            for (const auto& equation : equations) shaded.push_back(isPixelShaded(*equation));
+            newRevision = ++revision;
+            outdated = false;
+        }
 
-        delete[] vertices;
-        numVertices = 0;
+        std::vector<Snapshot> newSnapshots(equations.size());
+        if (governor) governor->resize(equations.size());
+        auto calculationStart = std::chrono::steady_clock::now();
 
-        auto* indexes = new unsigned long[equationList.size() + 1];
+        #pragma omp parallel for num_threads(Graph::NUM_THREADS) shared(equations, shaded, newSnapshots, region, precision, pixelSize, governor, interactive, newRevision) default(none)
+        for (int i = 0; i < equations.size(); i++) {
+            // Equations drawn per pixel are left without geometry
+            if (equations.at(i)->isPending() || shaded.at(i)) continue;
 
-        indexes[0] = 0;
-        for (int i = 0; i < equationList.size(); i++) {
-            indexes[i + 1] = indexes[i] + equationList.at(i)->getNumVertices(boundingBox, precision);
+            auto start = std::chrono::steady_clock::now();
+
+            double sampleWidth = governor ? governor->getSampleWidth(i, interactive) : 0;
+            double eqPrecision = governor ? sampleWidth * pixelSize : precision;
+
+            calculateSnapshot(*equations.at(i), newSnapshots.at(i), region, eqPrecision, pixelSize);
+            newSnapshots.at(i).revision = newRevision;
+
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            Counters::busyMicros.fetch_add((unsigned long) (elapsed.count() * 1000), std::memory_order_relaxed);
+            if (governor) governor->record(i, sampleWidth, elapsed.count());
         }
 
-        numVertices = indexes[equationList.size()];
-        vertices = new GLfloat[numVertices * 7];
+        std::chrono::duration<double, std::micro> calculationTime = std::chrono::steady_clock::now() - calculationStart;
+        Counters::capacityMicros.fetch_add((unsigned long) (calculationTime.count() * NUM_THREADS), std::memory_order_relaxed);
 
-        #pragma omp parallel for num_threads(Graph::NUM_THREADS) shared(indexes, precision) default(none)
-        for (int i = 0; i < equationList.size(); i++) {
-            equationList.at(i)->writeVertices(vertices + 7 * indexes[i], boundingBox, precision);
+        std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+        {
+            TraceSpan waitSpan("Graph mutex");
+            lock.lock();
+        }
+        // Equations that are still compiling keep the geometry they have by now, e.g. from a cache file
+        for (int i = 0; i < equations.size() && i < snapshots.size(); i++) {
+            if (equations.at(i)->isPending()) newSnapshots.at(i) = std::move(snapshots.at(i));
         }
+        // So do equations added meanwhile, which this calculation did not cover
+        for (unsigned long i = equations.size(); i < snapshots.size(); i++) {
+            newSnapshots.push_back(std::move(snapshots.at(i)));
+        }
+        snapshots = std::move(newSnapshots);
+        calculatedBounds = region;
+        calculatedPixelSize = pixelSize;
+    }
+
+
+    void Graph::calculateSnapshot(const Equation& equation, Snapshot& snapshot, BoundingBox region, double precision, double pixelSize) {
+        Counters::equationsCalculated.fetch_add(1, std::memory_order_relaxed);
+
+        TraceSpan span("Equation::writeGeometry");
+        equation.writeGeometry(snapshot, region, precision, pixelSize);
+        snapshot.bounds = region;
+        snapshot.precision = precision;
+    }
+
+
+    void Graph::setPixelShading(bool enabled) {
+        std::scoped_lock<std::mutex> lock(mutex);
+        if (pixelShading != enabled) outdated = true;
+        pixelShading = enabled;
+    }
+
+    bool Graph::isPixelShaded(const Equation& equation) const {
+        const std::string& expression = equation.getShaderExpression();
+        return pixelShading && !expression.empty() && !failedShaders.contains(expression);
+    }
+
+    void Graph::disablePixelShading(const std::string& expression) {
+        std::scoped_lock<std::mutex> lock(mutex);
+        failedShaders.insert(expression);
+        outdated = true;
+    }
+
+
+    // Whether the graph changed in a way the current snapshots do not reflect
+    bool Graph::isOutdated() {
+        std::scoped_lock<std::mutex> lock(mutex);
+        return outdated;
+    }
+
+    BoundingBox Graph::getCalculatedBounds() {
+        std::scoped_lock<std::mutex> lock(mutex);
+        return calculatedBounds;
+    }
+
+    double Graph::getCalculatedPixelSize() {
+        std::scoped_lock<std::mutex> lock(mutex);
+        return calculatedPixelSize;
+    }
+
+    // Whether a view can no longer be drawn from the current snapshots. Panning within the overscanned region
+    // only needs a new projection
+    bool Graph::isCalculationNeeded(const BoundingBox& visible, double pixelSize) {
+        std::scoped_lock<std::mutex> lock(mutex);
+        if (outdated) return true;
+
+        double zoomRatio = pixelSize / calculatedPixelSize;
+        if (zoomRatio > ZOOM_TOLERANCE || zoomRatio < 1 / ZOOM_TOLERANCE) return true;
 
-        delete[] indexes;
+        return !calculatedBounds.contains(visible.scaled(EDGE_MARGIN));
     }
 
 
     void Graph::addEquation(Equation* e) {
         std::scoped_lock<std::mutex> lock(mutex);
-        equationList.push_back(e);
+        equationList.emplace_back(e);
+        outdated = true;
+    }
+
+    // Replaces an equation, e.g. once it has finished compiling
+    void Graph::setEquation(int index, Equation* e) {
+        std::scoped_lock<std::mutex> lock(mutex);
+        equationList.at(index).reset(e);
+        outdated = true;
+    }
+
+
+    // Sets the geometry of an equation before it has been calculated
+    void Graph::setSnapshot(int index, Snapshot snapshot) {
+        std::scoped_lock<std::mutex> lock(mutex);
+        if (snapshots.size() <= index) snapshots.resize(index + 1);
+        snapshot.revision = ++revision;
+        snapshots.at(index) = std::move(snapshot);
+    }
+
+
+    bool Graph::hasGrid() const {
+        return grid;
+    }
+
+    void Graph::setGrid(bool enabled) {
+        grid = enabled;
     }
 
 
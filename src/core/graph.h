@@ -1,12 +1,15 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 #include <mutex>
-#include <QOpenGLBuffer>
+#include <unordered_set>
 #include <QString>
 
 #include "equations/equation.h"
 #include "core/bounding_box.h"
+#include "core/snapshot.h"
+#include "core/quality_governor.h"
 
 
 namespace Cubiq {
@@ -14,11 +17,25 @@ namespace Cubiq {
     class Graph {
 
     public:
+        using Snapshot = Cubiq::Snapshot;
+
         static const int NUM_THREADS;
+        static const float OVERSCAN;
+        static const float EDGE_MARGIN;
+        static const double ZOOM_TOLERANCE;
 
-        GLfloat* getVertices(unsigned long& numVerts);
-        GLfloat* getVertexList(unsigned long& numVerts);
+        const std::vector<std::shared_ptr<Equation>>& getEquations() const;
+        const std::vector<Snapshot>& getSnapshots() const;
         void calculateVertices(double precision);
+        void calculateVertices(BoundingBox region, double precision, double pixelSize = 0);
+        void calculateVertices(BoundingBox region, double pixelSize, QualityGovernor& governor, bool interactive);
+        void calculateViewport(BoundingBox viewport, int width, int height, double sampleWidth = 1);
+        std::vector<Snapshot> computeViewport(BoundingBox viewport, int width, int height, double sampleWidth = 1);
+
+        bool isOutdated();
+        BoundingBox getCalculatedBounds();
+        double getCalculatedPixelSize();
+        bool isCalculationNeeded(const BoundingBox& visible, double pixelSize);
 
         BoundingBox getBoundingBox();
         void setBoundingBox(BoundingBox bb);
@@ -30,6 +47,17 @@ namespace Cubiq {
         ~Graph();
 
         void addEquation(Equation* e);
+        void setEquation(int index, Equation* e);
+        void setSnapshot(int index, Snapshot snapshot);
+
+        bool hasGrid() const;
+        void setGrid(bool enabled);
+
+        // Views that can draw equations per pixel on the GPU enable this, so those equations get no geometry. Shaders
+        // that fail to build on the GPU are disabled, and their equations are calculated after all
+        void setPixelShading(bool enabled);
+        bool isPixelShaded(const Equation& equation) const; // Must be called with the mutex locked
+        void disablePixelShading(const std::string& expression);
 
         QString getName() const;
         QString getDescription() const;
@@ -44,10 +72,22 @@ namespace Cubiq {
 
         std::mutex mutex;
 
-        std::vector<Equation*> equationList;
+        // Shared so equations replaced during a calculation stay alive until it finishes
+        std::vector<std::shared_ptr<Equation>> equationList;
+
+        std::vector<Snapshot> snapshots;
+        unsigned long revision;
+
+        // Area and pixel size the snapshots were last calculated for
+        BoundingBox calculatedBounds;
+        double calculatedPixelSize;
+        bool outdated;
+
+        bool pixelShading;
+        std::unordered_set<std::string> failedShaders;
 
-        GLfloat* vertices;
-        unsigned long numVertices;
+        void calculateSnapshots(BoundingBox region, double precision, double pixelSize, QualityGovernor* governor, bool interactive);
+        static void calculateSnapshot(const Equation& equation, Snapshot& snapshot, BoundingBox region, double precision, double pixelSize);
 
         BoundingBox boundingBox;
 
@@ -0,0 +1,578 @@
+#include "graph_file.h"
+
+#include <cmath>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <optional>
+#include <utility>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QPointer>
+#include <QThreadPool>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include "core/geometry_cache.h"
+#include "equations/equation_parser.h"
+#include "equations/placeholder.h"
+#include "equations/data_table.h"
+#include "equations/parametric.h"
+
+
+namespace Cubiq {
+
+    namespace {
+
+        const qint64 CHUNK_SIZE = 1 << 16; // Bytes read from a graph file at a time
+
+        struct NamedColor {
+            const char* name;
+            Equation::DisplaySettings settings;
+        };
+
+        const NamedColor PALETTE[] = {
+                {"RED",    {0.8f, 0.3f, 0.3f, 0.9f}},
+                {"ORANGE", {0.9f, 0.6f, 0.2f, 0.9f}},
+                {"YELLOW", {0.8f, 0.8f, 0.2f, 0.9f}},
+                {"GREEN",  {0.2f, 0.8f, 0.2f, 0.9f}},
+                {"BLUE",   {0.2f, 0.2f, 0.8f, 0.9f}},
+                {"PURPLE", {0.8f, 0.2f, 0.8f, 0.9f}},
+                {"WHITE",  {0.9f, 0.9f, 0.9f, 0.9f}},
+        };
+
+        struct NamedStyle {
+            const char* name;
+            DataTable::Style style;
+        };
+
+        const NamedStyle TABLE_STYLES[] = {
+                {"line",    DataTable::Style::LINE},
+                {"points",  DataTable::Style::POINTS},
+                {"density", DataTable::Style::DENSITY},
+        };
+
+
+        // Splits a graph file into its header and the text of each element while it is being read, so elements can
+        // be compiled before the rest of the file has arrived. Only enough of the JSON structure is tracked to find
+        // the "elements" array; each piece is validated when it is parsed
+        class ElementScanner {
+
+        public:
+            explicit ElementScanner(std::function<void(std::string)> onElement) : onElement(std::move(onElement)) {}
+
+            void feed(const char* data, qint64 size) {
+                for (qint64 i = 0; i < size; i++) {
+                    char c = data[i];
+
+                    if (inString) {
+                        append(c);
+                        if (escaped) escaped = false;
+                        else if (c == '\\') escaped = true;
+                        else if (c == '"') inString = false;
+                        else if (depth == 1) key.push_back(c);
+                        continue;
+                    }
+
+                    switch (c) {
+                        case '"':
+                            append(c);
+                            inString = true;
+                            if (depth == 1) key.clear();
+                            break;
+                        case '{':
+                        case '[':
+                            if (inElements && depth == 2) target = &element;
+                            append(c);
+                            depth++;
+                            // The array itself is left empty in the header
+                            if (depth == 2 && c == '[' && key == "elements") {
+                                inElements = true;
+                                target = nullptr;
+                            }
+                            break;
+                        case '}':
+                        case ']':
+                            append(c);
+                            depth--;
+                            if (inElements && depth == 2 && target == &element) {
+                                onElement(std::move(element));
+                                element.clear();
+                                target = nullptr;
+                            } else if (inElements && depth == 1) {
+                                inElements = false;
+                                target = &header;
+                                header.push_back(c);
+                            }
+                            break;
+                        default:
+                            append(c);
+                    }
+                }
+            }
+
+            // The file without the contents of the elements array
+            const std::string& getHeader() const {
+                return header;
+            }
+
+        private:
+            std::function<void(std::string)> onElement;
+
+            std::string header, element, key;
+            std::string* target = &header;
+
+            int depth = 0;
+            bool inString = false, escaped = false, inElements = false;
+
+            void append(char c) {
+                if (target) target->push_back(c);
+            }
+
+        };
+
+
+        // Saves are written on a pool of their own, so they can be waited for without waiting for compilation. A single
+        // thread writes them in the order they were made, so the latest save of a file is the one that remains
+        QThreadPool& savePool() {
+            struct SavePool : QThreadPool {
+                SavePool() { setMaxThreadCount(1); }
+            };
+            static SavePool pool;
+            return pool;
+        }
+
+        int parseHexByte(const QString& s, int pos, bool& ok) {
+            return s.mid(pos, 2).toInt(&ok, 16);
+        }
+
+        QJsonObject serializeEquation(const Equation& equation) {
+            QJsonObject element;
+            element["type"] = QString::fromStdString(equation.getTypeName());
+            element["content"] = QString::fromStdString(equation.getSource());
+            element["color"] = colorName(equation.getDisplaySettings());
+
+            if (auto* table = dynamic_cast<const DataTable*>(&equation)) {
+                element["x"] = table->getColumns().x;
+                element["y"] = table->getColumns().y;
+                element["columns"] = table->getColumns().count;
+                for (const NamedStyle& style: TABLE_STYLES) {
+                    if (style.style == table->getStyle()) element["style"] = style.name;
+                }
+            }
+            if (auto* map = dynamic_cast<const ContourMap*>(&equation)) {
+                element["from"] = map->getLevels().from;
+                element["to"] = map->getLevels().to;
+                element["count"] = map->getLevels().count;
+                element["heatmap"] = map->hasHeatmap();
+            }
+            if (auto* curve = dynamic_cast<const Parametric*>(&equation)) {
+                element["from"] = curve->getFrom();
+                element["to"] = curve->getTo();
+            }
+            return element;
+        }
+
+        // Opens the data file of a table element. Its content is a path relative to the graph file
+        Equation* loadTable(const QJsonObject& element, const QString& directory, Equation::DisplaySettings settings,
+                            std::string& error) {
+            DataTable::Columns columns;
+            columns.x = element["x"].toInt(columns.x);
+            columns.y = element["y"].toInt(columns.y);
+            columns.count = element["columns"].toInt(columns.count);
+            DataTable::Style style = DataTable::Style::LINE;
+            for (const NamedStyle& named: TABLE_STYLES) {
+                if (element["style"].toString() == named.name) style = named.style;
+            }
+
+            QString path = QDir(directory).absoluteFilePath(element["content"].toString());
+            DataTable* table = DataTable::load(path, columns, style, settings, error);
+            if (table) table->setSource(element["content"].toString().toStdString());
+            return table;
+        }
+
+        // Levels are evenly spaced from one value to another, both included
+        Equation* loadContourMap(const QJsonObject& element, Equation::DisplaySettings settings) {
+            ContourMap::Levels levels;
+            levels.from = (float) element["from"].toDouble(levels.from);
+            levels.to = (float) element["to"].toDouble(levels.to);
+            levels.count = std::clamp(element["count"].toInt(levels.count), 1, ContourMap::MAX_LEVELS);
+            return parseContourMap(element["content"].toString().toStdString(), settings, levels,
+                                   element["heatmap"].toBool(false));
+        }
+
+        void applyHeader(Graph* graph, const QJsonObject& header) {
+            graph->setName(header["name"].toString(graph->getName()));
+            graph->setDescription(header["description"].toString());
+            graph->setAuthor(header["author"].toString());
+            graph->setGrid(header["show_grid"].toBool(true));
+
+            QJsonArray viewport = header["viewport"].toArray();
+            if (viewport.size() == 4) {
+                graph->setBoundingBox({(float) viewport[0].toDouble(), (float) viewport[1].toDouble(),
+                                       (float) viewport[2].toDouble(), (float) viewport[3].toDouble()});
+            }
+        }
+
+        Equation::DisplaySettings elementSettings(const QJsonObject& element) {
+            Equation::DisplaySettings settings = PALETTE[0].settings;
+            parseColor(element["color"].toString(), settings);
+            return settings;
+        }
+
+        // Creates the equation for a graph element. Elements that cannot be compiled become placeholders holding the
+        // error
+        Equation* createElement(const QJsonObject& element, const QString& directory) {
+            std::string type = element["type"].toString("xy").toStdString();
+            std::string content = element["content"].toString().toStdString();
+            Equation::DisplaySettings settings = elementSettings(element);
+
+            Equation* equation = nullptr;
+            std::string error;
+            try {
+                if (type == "table") equation = loadTable(element, directory, settings, error);
+                else if (type == "contour") equation = loadContourMap(element, settings);
+                else equation = parseEquation(type, content, settings);
+
+                // Curves are traced over the parameter range the element gives, if any
+                if (auto* curve = dynamic_cast<Parametric*>(equation)) {
+                    curve->setRange((float) element["from"].toDouble(curve->getFrom()),
+                                    (float) element["to"].toDouble(curve->getTo()));
+                }
+            } catch (const Parser::Error& e) {
+                error = describeError(e);
+            }
+
+            if (!equation) {
+                std::string text = QJsonDocument(element).toJson(QJsonDocument::Compact).toStdString();
+                equation = new Placeholder(settings, type, content, error, std::move(text));
+            }
+            return equation;
+        }
+
+    }
+
+
+    Graph* loadGraph(const QString& path, QString& error) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = file.errorString();
+            return nullptr;
+        }
+
+        QJsonParseError parseError{};
+        QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+        if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+            error = parseError.error != QJsonParseError::NoError ? parseError.errorString() : "Not a graph file";
+            return nullptr;
+        }
+
+        auto* graph = new Graph();
+        const QString directory = QFileInfo(path).absolutePath();
+        for (const QJsonValue& element: document.object()["elements"].toArray()) {
+            graph->addEquation(createElement(element.toObject(), directory));
+        }
+        applyHeader(graph, document.object());
+        return graph;
+    }
+
+    QStringList findGraphFiles(const QStringList& paths) {
+        QStringList files;
+        for (const QString& path: paths) {
+            if (!QFileInfo(path).isDir()) {
+                files.append(path);
+                continue;
+            }
+            for (const QFileInfo& entry: QDir(path).entryInfoList({"*.json"}, QDir::Files, QDir::Name)) {
+                files.append(entry.filePath());
+            }
+        }
+        return files;
+    }
+
+
+    struct GraphLoader::Result {
+        enum class Kind {
+            ELEMENT,  // A new element, as a placeholder
+            COMPILED, // Replacement for an element's placeholder
+            HEADER,
+            FINISHED,
+        };
+
+        Kind kind;
+        int index = 0;
+        std::unique_ptr<Equation> equation;
+        QJsonObject header;
+        QString error;
+        std::optional<Graph::Snapshot> snapshot; // Cached geometry for a new element
+    };
+
+    // Shared with the tasks on the thread pool, which may outlive the loader
+    struct GraphLoader::State {
+        std::mutex mutex;
+        std::atomic<bool> cancelled = false;
+        GraphLoader* receiver = nullptr; // Cleared when the loader is destroyed
+        std::vector<Result> results;
+
+        // Queues a result for the loader, waking it up if it is not already due to drain the queue
+        void post(Result result) {
+            std::scoped_lock<std::mutex> lock(mutex);
+            if (!receiver) return;
+            results.push_back(std::move(result));
+            if (results.size() == 1) {
+                GraphLoader* r = receiver;
+                QMetaObject::invokeMethod(r, [r] { r->drain(); }, Qt::QueuedConnection);
+            }
+        }
+    };
+
+
+    GraphLoader::GraphLoader(QString path, QObject* parent) :
+            QObject(parent), filePath(std::move(path)), graph(new Graph()), state(std::make_shared<State>()) {
+        state->receiver = this;
+    }
+
+    GraphLoader::~GraphLoader() {
+        std::scoped_lock<std::mutex> lock(state->mutex);
+        state->cancelled = true;
+        state->receiver = nullptr;
+    }
+
+
+    void GraphLoader::start() {
+        std::shared_ptr<State> s = state;
+        QString path = filePath;
+        QThreadPool::globalInstance()->start([s, path] { read(s, path); });
+    }
+
+    Graph* GraphLoader::getGraph() {
+        return graph;
+    }
+
+
+    // Applies the results posted so far. Runs on the loader's thread
+    void GraphLoader::drain() {
+        std::vector<Result> batch;
+        {
+            std::scoped_lock<std::mutex> lock(state->mutex);
+            batch.swap(state->results);
+        }
+
+        for (Result& result: batch) {
+            switch (result.kind) {
+                case Result::Kind::ELEMENT:
+                    graph->addEquation(result.equation.release());
+                    if (result.snapshot) graph->setSnapshot(result.index, std::move(*result.snapshot));
+                    emit elementAdded(result.index);
+                    break;
+                case Result::Kind::COMPILED:
+                    graph->setEquation(result.index, result.equation.release());
+                    emit elementChanged(result.index);
+                    break;
+                case Result::Kind::HEADER:
+                    applyHeader(graph, result.header);
+                    emit headerLoaded();
+                    break;
+                case Result::Kind::FINISHED:
+                    emit finished(result.error);
+                    break;
+            }
+        }
+    }
+
+
+    // Reads the file in chunks, handing out each element as soon as it is complete. Runs on the thread pool
+    void GraphLoader::read(const std::shared_ptr<State>& state, const QString& path) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            state->post({Result::Kind::FINISHED, 0, nullptr, {}, file.errorString()});
+            return;
+        }
+
+        // Geometry saved with the graph lets elements be drawn before they are compiled
+        std::shared_ptr<GeometryCache> cache = GeometryCache::open(GeometryCache::pathFor(path));
+
+        const QString directory = QFileInfo(path).absolutePath();
+        int numElements = 0;
+        ElementScanner scanner([&](std::string text) {
+            int index = numElements++;
+
+            QJsonParseError parseError{};
+            QJsonObject element = QJsonDocument::fromJson(QByteArray::fromStdString(text), &parseError).object();
+            std::string type = element["type"].toString("xy").toStdString();
+            std::string content = element["content"].toString().toStdString();
+            Equation::DisplaySettings settings = elementSettings(element);
+
+            if (parseError.error != QJsonParseError::NoError) {
+                auto* invalid = new Placeholder(settings, "", "", parseError.errorString().toStdString(),
+                                                std::move(text));
+                state->post({Result::Kind::ELEMENT, index, std::unique_ptr<Equation>(invalid)});
+                return;
+            }
+
+            // The placeholder is posted before the element is compiled, so it always arrives first
+            auto placeholder = std::make_unique<Placeholder>(settings, type, content, "", text);
+            Result result{Result::Kind::ELEMENT, index, std::move(placeholder)};
+            Graph::Snapshot snapshot{};
+            if (cache && cache->find(index, type, content, snapshot)) result.snapshot = std::move(snapshot);
+            state->post(std::move(result));
+            QThreadPool::globalInstance()->start([state, index, element, directory] {
+                compile(state, index, element, directory);
+            });
+        });
+
+        QByteArray chunk;
+        while (!state->cancelled && !(chunk = file.read(CHUNK_SIZE)).isEmpty()) {
+            scanner.feed(chunk.constData(), chunk.size());
+        }
+        if (state->cancelled) return;
+
+        QJsonParseError parseError{};
+        QJsonDocument header = QJsonDocument::fromJson(QByteArray::fromStdString(scanner.getHeader()), &parseError);
+        if (parseError.error != QJsonParseError::NoError || !header.isObject()) {
+            QString error = parseError.error != QJsonParseError::NoError ? parseError.errorString() : "Not a graph file";
+            state->post({Result::Kind::FINISHED, 0, nullptr, {}, error});
+            return;
+        }
+
+        state->post({Result::Kind::HEADER, 0, nullptr, header.object()});
+        state->post({Result::Kind::FINISHED});
+    }
+
+    void GraphLoader::compile(const std::shared_ptr<State>& state, int index, const QJsonObject& element,
+                              const QString& directory) {
+        if (state->cancelled) return;
+        state->post({Result::Kind::COMPILED, index, std::unique_ptr<Equation>(createElement(element, directory))});
+    }
+
+
+    void saveGraph(Graph* graph, const QString& path, bool writeCache, QObject* receiver, std::function<void(QString)> done) {
+        QJsonObject root;
+        root["name"] = graph->getName();
+        root["description"] = graph->getDescription();
+        root["author"] = graph->getAuthor();
+        root["show_grid"] = graph->hasGrid();
+
+        BoundingBox bb = graph->getBoundingBox();
+        root["viewport"] = QJsonArray{bb.minX, bb.maxX, bb.minY, bb.maxY};
+
+        QJsonArray elements;
+        auto cacheEntries = std::make_shared<std::vector<GeometryCache::Entry>>();
+        int invalid = -1; // First element that could not be read from the file, which cannot be written back
+        {
+            std::scoped_lock<std::mutex> lock(graph->getMutex());
+            const std::vector<std::shared_ptr<Equation>>& equations = graph->getEquations();
+            const std::vector<Graph::Snapshot>& snapshots = graph->getSnapshots();
+            for (int i = 0; i < equations.size(); i++) {
+                const Equation& equation = *equations.at(i);
+
+                // Placeholders are written back as they were read, with any fields only the compiled element uses
+                QJsonObject element;
+                auto* placeholder = dynamic_cast<const Placeholder*>(&equation);
+                if (placeholder && !placeholder->getElement().empty()) {
+                    QJsonParseError parseError{};
+                    QJsonDocument text = QJsonDocument::fromJson(QByteArray::fromStdString(placeholder->getElement()),
+                                                                 &parseError);
+                    element = text.object();
+                    if (parseError.error != QJsonParseError::NoError || !text.isObject()) {
+                        invalid = i;
+                        break;
+                    }
+                } else if (equation.getTypeName().empty() || equation.getSource().empty()) {
+                    // Elements that were not loaded from source cannot be written back
+                    continue;
+                } else {
+                    element = serializeEquation(equation);
+                }
+
+                // The cache only holds segments in a single color, so anything else is recalculated on opening. Nor is
+                // the range of a curve part of its key
+                const Graph::Snapshot* snapshot = i < snapshots.size() ? &snapshots.at(i) : nullptr;
+                const bool cacheable = snapshot && snapshot->revision != 0 && snapshot->fill.empty() &&
+                                       snapshot->colors.empty() && snapshot->density.empty() &&
+                                       !dynamic_cast<const Parametric*>(&equation);
+                if (writeCache && cacheable) {
+                    cacheEntries->push_back({(quint32) elements.size(), equation.getTypeName(), equation.getSource(),
+                                             snapshot->bounds, snapshot->precision,
+                                             std::vector<float>(snapshot->data(), snapshot->data() + snapshot->size())});
+                }
+                elements.append(element);
+            }
+        }
+
+        // The receiver may be destroyed while the file is written, e.g. by closing its window, and is then not called
+        QPointer<QObject> guard(receiver);
+
+        // Saving would silently drop the element, so the file is left as it is until the element is removed
+        if (invalid >= 0) {
+            QString error = QString("Element %1 could not be read, and saving would drop it").arg(invalid + 1);
+            if (guard) {
+                QMetaObject::invokeMethod(guard.data(), [guard, done, error] {
+                    if (guard) done(error);
+                }, Qt::QueuedConnection);
+            }
+            return;
+        }
+
+        root["elements"] = elements;
+        QByteArray data = QJsonDocument(root).toJson();
+        savePool().start([path, data, writeCache, cacheEntries, guard, done] {
+            QString error;
+            QSaveFile file(path);
+            if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+                error = file.errorString();
+            } else if (writeCache) {
+                // The cache is optional, so failing to write it is not an error
+                GeometryCache::write(GeometryCache::pathFor(path), *cacheEntries);
+            }
+            if (guard.isNull()) return;
+            QMetaObject::invokeMethod(guard.data(), [guard, done, error] {
+                if (guard) done(error);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+
+    void waitForSaves() {
+        savePool().waitForDone();
+    }
+
+
+    bool parseColor(const QString& name, Equation::DisplaySettings& settings) {
+        for (const NamedColor& color: PALETTE) {
+            if (name.compare(color.name, Qt::CaseInsensitive) == 0) {
+                settings = color.settings;
+                return true;
+            }
+        }
+
+        // #RRGGBB or #RRGGBBAA
+        if (!name.startsWith('#') || (name.length() != 7 && name.length() != 9)) return false;
+        bool okR, okG, okB, okA = true;
+        int r = parseHexByte(name, 1, okR), g = parseHexByte(name, 3, okG), b = parseHexByte(name, 5, okB);
+        int a = name.length() == 9 ? parseHexByte(name, 7, okA) : 255;
+        if (!okR || !okG || !okB || !okA) return false;
+
+        settings.r = (float) r / 255.0f;
+        settings.g = (float) g / 255.0f;
+        settings.b = (float) b / 255.0f;
+        settings.a = (float) a / 255.0f;
+        return true;
+    }
+
+    QString colorName(const Equation::DisplaySettings& settings) {
+        for (const NamedColor& color: PALETTE) {
+            const Equation::DisplaySettings& c = color.settings;
+            if (c.r == settings.r && c.g == settings.g && c.b == settings.b && c.a == settings.a) return color.name;
+        }
+
+        auto hex = [](float v) { return QString("%1").arg((int) std::lround(v * 255.0f), 2, 16, QChar('0')); };
+        return "#" + hex(settings.r) + hex(settings.g) + hex(settings.b) + hex(settings.a);
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <functional>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+
+#include "core/graph.h"
+
+
+namespace Cubiq {
+
+    // Loads a graph file in the background. The graph is available immediately and is filled with a placeholder for
+    // each element as the file is read. Elements are compiled in parallel on the global thread pool and swapped in as
+    // they finish, so the UI never waits for the parser
+    class GraphLoader : public QObject {
+    Q_OBJECT
+
+    public:
+        GraphLoader(QString path, QObject* parent = nullptr);
+        ~GraphLoader() override; // Cancels any work still pending
+
+        void start();
+
+        // The graph being loaded. Ownership is the caller's, but the loader must be destroyed before the graph is
+        Graph* getGraph();
+
+    signals:
+        void elementAdded(int index);
+        void elementChanged(int index);
+        void headerLoaded();
+        void finished(QString error); // Empty if the whole file was read, even if some elements failed to compile
+
+    private:
+        struct Result;
+        struct State;
+
+        QString filePath;
+        Graph* graph;
+        std::shared_ptr<State> state;
+
+        void drain();
+
+        static void read(const std::shared_ptr<State>& state, const QString& path);
+        static void compile(const std::shared_ptr<State>& state, int index, const QJsonObject& element,
+                            const QString& directory);
+
+    };
+
+
+    // Reads a whole graph file on the calling thread, for use without an event loop. Elements that fail to compile
+    // are kept as placeholders. Returns nullptr and sets the error if the file cannot be read at all
+    Graph* loadGraph(const QString& path, QString& error);
+    // Graph files given directly, and every graph file in each directory given
+    QStringList findGraphFiles(const QStringList& paths);
+
+    // Serializes the graph on the calling thread and writes it in the background, optionally along with its current
+    // geometry. done is called on the receiver's thread afterwards, with an error message if the file could not be
+    // written, unless the receiver has been destroyed by then
+    void saveGraph(Graph* graph, const QString& path, bool writeCache, QObject* receiver, std::function<void(QString)> done);
+    // Blocks until every save started so far has been written, without waiting for elements being compiled
+    void waitForSaves();
+
+    // Converts between display colors and their names in graph files, e.g. "RED" or "#ff8000"
+    bool parseColor(const QString& name, Equation::DisplaySettings& settings);
+    QString colorName(const Equation::DisplaySettings& settings);
+
+}
\ No newline at end of file
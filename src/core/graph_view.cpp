@@ -1,46 +1,145 @@
 #include "graph_view.h"
 
 #include <cmath>
+#include <cstring>
+#include <cfloat>
+#include <algorithm>
 #include <iostream>
 
 #include <QWheelEvent>
+#include <QSettings>
+#include <QPainter>
+#include <QFontDatabase>
+#include <QLocale>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+
+#include "core/trace.h"
+#include "core/counters.h"
 
 
 namespace Cubiq {
 
     #include "shader/basic_vertex_glsl.h"
     #include "shader/basic_fragment_glsl.h"
+    #include "shader/grid_vertex_glsl.h"
+    #include "shader/grid_fragment_glsl.h"
+    #include "shader/line_vertex_glsl.h"
+    #include "shader/line_fragment_glsl.h"
+    #include "shader/density_vertex_glsl.h"
+    #include "shader/density_fragment_glsl.h"
+    #include "shader/implicit_fragment_glsl.h"
+
 
 
-    const int GraphView::BATCH_SIZE = 5000;
+    const GLsizei VERTEX_BYTES = Equation::FLOATS_PER_VERTEX * sizeof(GLfloat);
+    const int PADDING_VERTICES = 2; // Before and after the segments of each equation, read as neighbours of the ends
+    const int OVERLAY_MILLIS = 500; // Period over which the overlay's rates are measured
+    const int CACHED_PROGRAMS = 32; // Binaries kept on disk, so those of old drivers and versions are dropped
 
-    const GLsizei VERTEX_BYTES = 7 * sizeof(GLfloat);
+    namespace {
+
+        long long steadyMillis() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // Lines put before every shader for the context's GLSL, given e.g. "4.50 (Core Profile) Mesa" or "OpenGL ES GLSL
+        // ES 3.20": the #version directive, capped to the latest the shaders were written against, and for ES the
+        // default precision fragment shaders lack
+        std::string glslPreamble(const std::string& version, bool es) {
+            const size_t start = version.find_first_of("0123456789");
+            std::string number;
+            for (size_t i = start; i < version.size() && (std::isdigit(version[i]) || version[i] == '.'); i++) {
+                if (version[i] != '.') number += version[i];
+            }
+            if (number.empty()) number = es ? "300" : "130";
+
+            // ES 2.0 has only version 100, which takes no suffix
+            const int latest = es ? 320 : 460;
+            if (std::stoi(number) > latest) number = std::to_string(latest);
+            return "#version " + number + (es && std::stoi(number) >= 300 ? " es" : "") + "\n" +
+                   (es ? "precision highp float;\n" : "");
+        }
+
+        // Implicit programs are built and cached by expression, and whether they shade a region
+        const std::string REGION_DEFINE = "#define REGION\n";
+
+        std::string implicitKey(const std::string& expression, bool region) {
+            return (region ? REGION_DEFINE : "") + expression;
+        }
+
+        // Same as comparing to implicitKey(), without building the key every frame
+        bool isImplicitKey(const std::string& key, const std::string& expression, bool region) {
+            const size_t prefix = region ? REGION_DEFINE.size() : 0;
+            return !expression.empty() && key.size() == prefix + expression.size() &&
+                   key.compare(0, prefix, REGION_DEFINE, 0, prefix) == 0 && key.compare(prefix, expression.size(), expression) == 0;
+        }
+
+        double steadyMicros() {
+            return (double) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+    }
 
 
     GraphView::GraphView(QWidget* parent, Graph* g) :
             QOpenGLWidget(parent),
-            calculationThread(this, g), graph(g),
             dragging(false), dragStartBounds{0, 0, 0, 0},
             clearR(0.133f), clearG(0.133f), clearB(0.133f),
             screenW(0), screenH(0),
-            gridSpaceX(1), gridSpaceY(1), gridMajorX(5), gridMajorY(5) {
+            graph(g),
+            calculationLoop(g, 3, 16, [this](Graph& shown, BoundingBox& visible, double& pixelSize) {
+                if (screenW <= 0) return false;
+                visible = getVisibleBounds(shown.getBoundingBox());
+                pixelSize = (double) visible.width() / (double) screenW;
+                return true;
+            }, [this] { update(); }),
+            gridSpaceX(1), gridSpaceY(1), gridMajorX(5), gridMajorY(5),
+            overlay(false),
+            recording(false), recordingStart(0),
+            replayIndex(0), replayStart(0) {
+        loadSettings();
+
+        overlayTimer.setInterval(OVERLAY_MILLIS);
+        connect(&overlayTimer, &QTimer::timeout, this, [this]() {
+            sampleCounters();
+            update();
+        });
+
+        replayTimer.setTimerType(Qt::PreciseTimer);
+        replayTimer.setInterval((int) LatencyRecorder::FRAME_MILLIS);
+        connect(&replayTimer, &QTimer::timeout, this, &GraphView::replayFrame);
     }
 
     GraphView::~GraphView() {
-        calculationThread.markToExit();
-        calculationThread.join();
+        calculationLoop.stop();
+
+        makeCurrent();
+        releaseBuffers();
+        doneCurrent();
 
         delete graph;
     }
 
 
     void GraphView::setGraph(Graph* g) {
+        // Buffers belong to the old graph's equations
+        makeCurrent();
+        releaseBuffers();
+        doneCurrent();
+
+        // Waits for any calculation still using the old graph
+        calculationLoop.setGraph(g);
         delete graph;
         graph = g;
-        calculationThread.setGraph(g);
+        graph->setPixelShading(pixelShading);
 
         adjustCamera();
-        calculationThread.markToUpdate();
+        calculationLoop.markToUpdate();
         update();
     }
 
@@ -49,43 +148,177 @@ namespace Cubiq {
     }
 
 
+    // Applies a change to the graph's bounding box made outside of the view
+    void GraphView::updateView() {
+        adjustCamera();
+        calculationLoop.markToUpdate();
+        update();
+    }
+
     void GraphView::centerOrigin() {
         BoundingBox bb = graph->getBoundingBox();
         graph->setBoundingBox(bb.moved(-bb.centerX(), -bb.centerY()));
+        viewChanged();
+    }
 
-        adjustCamera();
-        calculationThread.markToUpdate();
+
+    void GraphView::loadSettings() {
+        QSettings settings;
+        calculationLoop.setQuality(
+                settings.value("display/sampleWidth", 3).toDouble(),
+                settings.value("display/frameBudget", 16).toDouble());
+    }
+
+
+    bool GraphView::hasOverlay() const {
+        return overlay;
+    }
+
+    void GraphView::setOverlay(bool enabled) {
+        overlay = enabled;
+        if (overlay) {
+            sampleCounters();
+            overlayTimer.start();
+        } else {
+            overlayTimer.stop();
+        }
         update();
     }
 
 
+    bool GraphView::isRecording() const {
+        return recording;
+    }
+
+    // The view at the start is recorded as the first change
+    void GraphView::startRecording() {
+        recorded = Interaction();
+        recorded.width = screenW;
+        recorded.height = screenH;
+        recorded.events.push_back({0, graph->getBoundingBox()});
+        recordingStart = steadyMillis();
+        recording = true;
+    }
+
+    Interaction GraphView::stopRecording() {
+        recording = false;
+        return std::move(recorded);
+    }
+
+
+    bool GraphView::isReplaying() const {
+        return latency != nullptr;
+    }
+
+    void GraphView::replay(const Interaction& interaction, std::function<void(QJsonObject)> done) {
+        replayed = interaction;
+        replayIndex = 0;
+        replayStart = (long long) steadyMicros();
+        latency = std::make_unique<LatencyRecorder>();
+        replayDone = std::move(done);
+        replayTimer.start();
+        replayFrame();
+    }
+
+    // Applies every change that is due, as if it had just been made by the user, and requests the next frame
+    void GraphView::replayFrame() {
+        const auto now = (long long) steadyMicros();
+        const long long elapsed = (now - replayStart) / 1000;
+
+        while (replayIndex < replayed.events.size() && replayed.events[replayIndex].millis <= elapsed) {
+            graph->setBoundingBox(replayed.events[replayIndex++].bounds);
+            adjustCamera();
+            latency->input(calculationLoop.markToUpdate(), now);
+        }
+
+        const bool applied = replayIndex == replayed.events.size();
+        if (applied && (latency->isSettled() || elapsed > replayed.events.back().millis + LatencyRecorder::TIMEOUT_MILLIS)) {
+            finishReplay();
+        } else {
+            update();
+        }
+    }
+
+    void GraphView::finishReplay() {
+        replayTimer.stop();
+        QJsonObject report = latency->report();
+        report["width"] = screenW;
+        report["height"] = screenH;
+        latency.reset();
+
+        std::function<void(QJsonObject)> done = std::move(replayDone);
+        replayDone = nullptr;
+        if (done) done(report);
+    }
+
+
+    // The area actually shown on screen, which depends on the aspect ratio of the widget
+    BoundingBox GraphView::getVisibleBounds() const {
+        return getVisibleBounds(graph->getBoundingBox());
+    }
+
+    BoundingBox GraphView::getVisibleBounds(const BoundingBox& bounds) const {
+        return bounds.withAspect((float) screenH / (float) screenW);
+    }
+
+
     void GraphView::initializeGL() {
         initializeOpenGLFunctions();
 
-        // Configure rendering
-        glEnable(GL_MULTISAMPLE);
+        // Configure rendering (no multisampling; lines are anti-aliased by their shader)
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
         // Configure screen clear color
         glClearColor(clearR, clearG, clearB, 1);
 
-        // Compile and link shader program
-        const char* attribs[] = {"vPos", "vColor"};
-        shaderProgram = createShader(BASIC_VERTEX_GLSL, BASIC_FRAGMENT_GLSL, 2, attribs);
+        // Instanced line quads need OpenGL 3.3 (or ES 3.0), otherwise fall back to plain GL_LINES
+        const QSurfaceFormat format = context()->format();
+        instancedLines = context()->isOpenGLES() ? format.majorVersion() >= 3 : format.version() >= qMakePair(3, 3);
+
+        // Program binaries need OpenGL 4.1 (or ES 3.0, or the extension), and a driver that offers at least one format
+        GLint binaryFormats = 0;
+        programBinaries = context()->isOpenGLES() ? format.majorVersion() >= 3 :
+                          format.version() >= qMakePair(4, 1) || context()->hasExtension("GL_ARB_get_program_binary");
+        if (programBinaries) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+        programBinaries = binaryFormats > 0;
+
+        // Implicit equations and inequalities are drawn by shaders generated from them, which need screen-space
+        // derivatives. Every version with instanced lines has them, including software rasterizers such as llvmpipe
+        pixelShading = instancedLines;
+        graph->setPixelShading(pixelShading);
+
+        // Compile and link shader programs
+        const char* attribs[] = {"vPos"};
+        const char* lineAttribs[] = {"vCorner", "vStart", "vEnd", "vPrevStart", "vPrevEnd", "vNextStart", "vNextEnd"};
+        shaderProgram = createShader(BASIC_VERTEX_GLSL, BASIC_FRAGMENT_GLSL, 1, attribs);
+        gridProgram = createShader(GRID_VERTEX_GLSL, GRID_FRAGMENT_GLSL, 1, attribs);
+        densityProgram = createShader(DENSITY_VERTEX_GLSL, DENSITY_FRAGMENT_GLSL, 1, attribs);
+        if (instancedLines)
+            lineProgram = createShader(LINE_VERTEX_GLSL, LINE_FRAGMENT_GLSL, 7, lineAttribs);
         glUseProgram(shaderProgram);
 
         // Generate vertex array object
         glGenVertexArrays(1, &vertexArray);
         glBindVertexArray(vertexArray);
 
-        // Generate vertex buffer object
-        glGenBuffers(1, &vertexBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-
-        // Configure vertex attributes (0 = vec3 vPos, 1 = vec4 vColor)
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (void*) (0));
-        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (void*) (3 * sizeof(GLfloat)));
+        // Generate the grid's full-viewport quad, which never changes
+        const GLfloat quad[] = {-1, -1, 1, -1, -1, 1, 1, 1};
+        glGenBuffers(1, &gridBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, gridBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+        // Generate the quad each line segment is extruded from
+        const GLfloat lineQuad[] = {0, -1, 1, -1, 0, 1, 1, 1};
+        glGenBuffers(1, &lineQuadBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, lineQuadBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(lineQuad), lineQuad, GL_STATIC_DRAW);
+
+        // Segment endpoints (1 = vec2 vStart, 2 = vec2 vEnd) and those of the segments either side (3 to 6) advance
+        // once per instance
+        if (instancedLines) {
+            for (GLuint attrib = 1; attrib <= 6; attrib++) glVertexAttribDivisor(attrib, 1);
+        }
 
         // Unbind VAO/VBO
         glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -100,127 +333,441 @@ namespace Cubiq {
         setMinimumWidth(h / 8);
 
         adjustCamera();
-        calculationThread.markToUpdate();
+        calculationLoop.markToUpdate();
         update();
     }
 
 
     void GraphView::paintGL() {
+        TraceSpan span("GraphView::paintGL");
+        const double frameStart = steadyMicros();
+        // Read before uploading, so everything handled by then is certain to be drawn
+        const unsigned long handledSerial = calculationLoop.getHandledSerial();
+        stats.verticesDrawn = 0;
+        stats.bytesUploaded = 0;
+
         initializeOpenGLFunctions();
 
         // Prepare the screen
         glClear(GL_COLOR_BUFFER_BIT);
 
-        // Upload projection matrix to shader
-        glUseProgram(shaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "uProjection"), 1, GL_FALSE, projection.data());
-
-        // Prepare VAO/VBO
+        // Prepare VAO
         glBindVertexArray(vertexArray);
         glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, BATCH_SIZE * VERTEX_BYTES, NULL, GL_DYNAMIC_DRAW);
 
-        // Load geometry onto the buffer and draw
-        drawGrid();
+        // The grid is generated by its own shader
+        if (graph->hasGrid()) drawGrid();
+
+        // Equations are drawn from their own buffers
         drawElements();
 
         // Unbind VAO/VBO
         glBindVertexArray(0);
         glDisableVertexAttribArray(0);
-        glDisableVertexAttribArray(1);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
         // Stop using shader program
         glUseProgram(0);
+
+        // Smoothed over roughly the last ten frames
+        const double frameEnd = steadyMicros();
+        stats.frameMillis += 0.1 * ((frameEnd - frameStart) / 1000 - stats.frameMillis);
+        if (stats.lastFrame > 0) stats.frameInterval += 0.1 * ((frameStart - (double) stats.lastFrame) / 1000 - stats.frameInterval);
+        stats.lastFrame = (long long) frameStart;
+        if (latency) latency->frame(handledSerial, (long long) frameEnd);
+
+        if (overlay) drawOverlay();
     }
 
 
     void GraphView::drawGrid() {
-        const float aspect = (float) screenH / (float) screenW;
-
-        const BoundingBox& bounds = graph->getBoundingBox();
+        const BoundingBox visible = getVisibleBounds();
 
         const float minorAlpha = 0.05f;
         const float majorAlpha = 0.2f;
         const float axisAlpha = 0.5f;
 
-        GLfloat axes[] = {
-                0, bounds.centerY() - bounds.height() * aspect, 0, 1, 1, 1, axisAlpha,
-                0, bounds.centerY() + bounds.height() * aspect, 0, 1, 1, 1, axisAlpha,
-                bounds.minX, 0, 0, 1, 1, 1, axisAlpha,
-                bounds.maxX, 0, 0, 1, 1, 1, axisAlpha,
-        };
-        glBufferSubData(GL_ARRAY_BUFFER, 0, 4 * VERTEX_BYTES, axes);
-
-        int index = 4;
-
-        for (float x = std::floor(bounds.minX / gridSpaceX) * gridSpaceX;
-                x <= std::ceil(bounds.maxX / gridSpaceX) * gridSpaceX;
-                x += gridSpaceX) {
-            if (x != 0) {
-                float alpha = (int) std::round(x / gridSpaceX) % gridMajorX == 0 ? majorAlpha : minorAlpha;
-                GLfloat line[] = {
-                        x, bounds.centerY() - bounds.height() * aspect, 0, 1, 1, 1, alpha,
-                        x, bounds.centerY() + bounds.height() * aspect, 0, 1, 1, 1, alpha,
-                };
-                glBufferSubData(GL_ARRAY_BUFFER, index * VERTEX_BYTES, 2 * VERTEX_BYTES, line);
-                index += 2;
+        glUseProgram(gridProgram);
+        glUniform2f(glGetUniformLocation(gridProgram, "uViewMin"), visible.minX, visible.minY);
+        glUniform2f(glGetUniformLocation(gridProgram, "uViewMax"), visible.maxX, visible.maxY);
+        glUniform2f(glGetUniformLocation(gridProgram, "uGridSpace"), gridSpaceX, gridSpaceY);
+        glUniform2f(glGetUniformLocation(gridProgram, "uGridMajor"), (float) gridMajorX, (float) gridMajorY);
+        glUniform2f(glGetUniformLocation(gridProgram, "uPixelSize"), visible.width() / (float) screenW, visible.height() / (float) screenH);
+        glUniform3f(glGetUniformLocation(gridProgram, "uAlpha"), minorAlpha, majorAlpha, axisAlpha);
+
+        // Every line is drawn by a single pass over the viewport
+        glBindBuffer(GL_ARRAY_BUFFER, gridBuffer);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (void*) (0));
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+
+
+    void GraphView::drawElements() {
+        TraceSpan span("GraphView::drawElements");
+
+        // Lock the graph's mutex while drawing
+        std::unique_lock<std::mutex> lock(graph->getMutex(), std::defer_lock);
+        {
+            TraceSpan waitSpan("Graph mutex");
+            lock.lock();
+        }
+
+        uploadSnapshots();
+        pruneImplicitPrograms();
+        drawDensities();
+        drawFills();
+
+        std::vector<std::string> failedShaders;
+        drawPixelShaded(failedShaders);
+
+        const std::vector<std::shared_ptr<Equation>>& equations = graph->getEquations();
+        const GLuint program = instancedLines ? lineProgram : shaderProgram;
+
+        // Upload projection matrix to shader
+        glUseProgram(program);
+        glUniformMatrix4fv(glGetUniformLocation(program, "uProjection"), 1, GL_FALSE, projection.data());
+        glUniform2f(glGetUniformLocation(program, "uViewport"), (float) screenW, (float) screenH);
+
+        const GLint colorLocation = glGetUniformLocation(program, "uColor");
+        const GLint lineWidthLocation = glGetUniformLocation(program, "uLineWidth");
+
+        if (instancedLines) {
+            glBindBuffer(GL_ARRAY_BUFFER, lineQuadBuffer);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (void*) (0));
+            for (GLuint attrib = 1; attrib <= 6; attrib++) glEnableVertexAttribArray(attrib);
+        }
+
+        const std::vector<Graph::Snapshot>& snapshots = graph->getSnapshots();
+        for (int i = 0; i < equationBuffers.size(); i++) {
+            const EquationBuffer& eb = equationBuffers.at(i);
+            if (eb.count == 0) continue;
+
+            // Color and line style are constant for each equation, or for each run of one drawn in several colors
+            const Equation::DisplaySettings& ds = equations.at(i)->getDisplaySettings();
+            const std::vector<Equation::ColorRun>& runs = snapshots.at(i).colors;
+            if (instancedLines) glUniform1f(lineWidthLocation, ds.lineWidth);
+            else glLineWidth(ds.lineWidth);
+
+            glBindBuffer(GL_ARRAY_BUFFER, eb.buffer);
+            stats.verticesDrawn += eb.count;
+            unsigned long first = 0;
+            for (int r = 0; r < std::max(1, (int) runs.size()); r++) {
+                const Equation::ColorRun run = runs.empty() ?
+                        Equation::ColorRun{(unsigned long) eb.count, ds.r, ds.g, ds.b, ds.a} : runs.at(r);
+                glUniform4f(colorLocation, run.r, run.g, run.b, run.a);
+
+                const unsigned long start = first + PADDING_VERTICES;
+                if (instancedLines) {
+                    // Each pair of vertices is one segment, extruded into a quad on screen, with the pairs before and
+                    // after it to find where the curve continues
+                    const long offsets[] = {0, 1, -2, -1, 2, 3};
+                    for (GLuint attrib = 1; attrib <= 6; attrib++) {
+                        const long vertex = (long) start + offsets[attrib - 1];
+                        glVertexAttribPointer(attrib, 2, GL_FLOAT, GL_FALSE, 2 * VERTEX_BYTES, (void*) (vertex * VERTEX_BYTES));
+                    }
+                    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei) (run.count / 2));
+                } else {
+                    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, VERTEX_BYTES, (void*) (0));
+                    glDrawArrays(GL_LINES, (GLint) start, (GLsizei) run.count);
+                }
+                first += run.count;
+            }
+        }
+
+        if (instancedLines) {
+            for (GLuint attrib = 1; attrib <= 6; attrib++) glDisableVertexAttribArray(attrib);
+        }
+
+        // Their equations are calculated on the CPU from now on, which needs the graph's mutex
+        lock.unlock();
+        for (const std::string& expression : failedShaders) graph->disablePixelShading(expression);
+    }
+
+    // Each equation drawn per pixel is a pass over the whole viewport with its own shader. Must be called with the
+    // graph's mutex locked, so shaders that fail to build are only returned, to be disabled afterwards
+    void GraphView::drawPixelShaded(std::vector<std::string>& failed) {
+        const BoundingBox visible = getVisibleBounds();
+
+        glBindBuffer(GL_ARRAY_BUFFER, gridBuffer);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (void*) (0));
+
+        for (const std::shared_ptr<Equation>& equation : graph->getEquations()) {
+            if (!graph->isPixelShaded(*equation)) continue;
+
+            const GLuint program = implicitProgram(equation->getShaderExpression(), equation->isShaderRegion());
+            if (program == 0) {
+                failed.push_back(equation->getShaderExpression());
+                continue;
             }
+
+            const Equation::DisplaySettings& ds = equation->getDisplaySettings();
+            glUseProgram(program);
+            glUniform2f(glGetUniformLocation(program, "uViewMin"), visible.minX, visible.minY);
+            glUniform2f(glGetUniformLocation(program, "uViewMax"), visible.maxX, visible.maxY);
+            glUniform2f(glGetUniformLocation(program, "uPixelSize"), visible.width() / (float) screenW, visible.height() / (float) screenH);
+            glUniform4f(glGetUniformLocation(program, "uColor"), ds.r, ds.g, ds.b, ds.a);
+            glUniform1f(glGetUniformLocation(program, "uLineWidth"), ds.lineWidth);
+            glUniform1f(glGetUniformLocation(program, "uFillAlpha"), Equation::FILL_ALPHA);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
         }
+    }
 
-        for (float y = std::floor((bounds.centerY() - bounds.height() * aspect) / gridSpaceY) * gridSpaceY;
-                y <= std::ceil((bounds.centerY() + bounds.height() * aspect) / gridSpaceY) * gridSpaceY;
-                y += gridSpaceY) {
-            if (y != 0) {
-                float alpha = (int) std::round(y / gridSpaceY) % gridMajorY == 0 ? majorAlpha : minorAlpha;
-                GLfloat line[] = {
-                        bounds.minX, y, 0, 1, 1, 1, alpha,
-                        bounds.maxX, y, 0, 1, 1, 1, alpha,
-                };
-                glBufferSubData(GL_ARRAY_BUFFER, index * VERTEX_BYTES, 2 * VERTEX_BYTES, line);
-                index += 2;
+    // Builds the shader of an equation the first time it is drawn, reusing the grid's full-viewport vertex shader
+    GLuint GraphView::implicitProgram(const std::string& expression, bool region) {
+        const std::string key = implicitKey(expression, region);
+        auto it = implicitPrograms.find(key);
+        if (it != implicitPrograms.end()) return it->second;
+
+        const std::string fragmentSource = (region ? REGION_DEFINE : "") + std::string(IMPLICIT_FRAGMENT_GLSL) +
+                "float equation(float x, float y) {\n    return " + expression + ";\n}\n";
+        const char* attribs[] = {"vPos"};
+        // Not cached on disk, as every expression ever typed would leave a binary behind
+        GLuint program = createShader(GRID_VERTEX_GLSL, fragmentSource.c_str(), 1, attribs, false);
+
+        // e.g. an expression too long for the driver
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status == GL_FALSE) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+
+        implicitPrograms[key] = program;
+        return program;
+    }
+
+    // Programs of expressions no longer in the graph, e.g. after an equation is edited, would otherwise be kept until
+    // the context is destroyed. Must be called with the graph's mutex locked
+    void GraphView::pruneImplicitPrograms() {
+        const std::vector<std::shared_ptr<Equation>>& equations = graph->getEquations();
+        for (auto it = implicitPrograms.begin(); it != implicitPrograms.end();) {
+            const bool used = std::any_of(equations.begin(), equations.end(), [&it](const std::shared_ptr<Equation>& e) {
+                return isImplicitKey(it->first, e->getShaderExpression(), e->isShaderRegion());
+            });
+            if (used) {
+                ++it;
+                continue;
             }
+            if (it->second != 0) glDeleteProgram(it->second);
+            it = implicitPrograms.erase(it);
+        }
+    }
+
+
+    // Re-uploads the geometry of each equation whose snapshot changed since the last frame.
+    // Must be called with the graph's mutex locked
+    void GraphView::uploadSnapshots() {
+        const std::vector<Graph::Snapshot>& snapshots = graph->getSnapshots();
+        bool uploaded = false;
+
+        while (equationBuffers.size() > snapshots.size()) {
+            glDeleteBuffers(1, &equationBuffers.back().buffer);
+            glDeleteBuffers(1, &equationBuffers.back().fillBuffer);
+            glDeleteTextures(1, &equationBuffers.back().texture);
+            equationBuffers.pop_back();
+        }
+        while (equationBuffers.size() < snapshots.size()) {
+            EquationBuffer eb{0, 0, 0, 0, false, {0, 0, 0, 0}, 0, 0};
+            glGenBuffers(1, &eb.buffer);
+            equationBuffers.push_back(eb);
         }
 
-        // Draw regular grid [4, index)
-        glLineWidth(1);
-        glDrawArrays(GL_LINES, 4, index - 4);
+        for (int i = 0; i < snapshots.size(); i++) {
+            const Graph::Snapshot& snapshot = snapshots.at(i);
+            EquationBuffer& eb = equationBuffers.at(i);
+            if (eb.revision == snapshot.revision) continue;
+
+            TraceSpan span("GraphView::upload");
+            eb.count = (GLsizei) (snapshot.size() / Equation::FLOATS_PER_VERTEX);
+            eb.revision = snapshot.revision;
+            // Padded with vertices no segment ends at, so the first and last segments have neighbours to read that
+            // never join them
+            const std::vector<GLfloat> padding(PADDING_VERTICES * Equation::FLOATS_PER_VERTEX, FLT_MAX);
+            const GLsizeiptr paddingBytes = PADDING_VERTICES * VERTEX_BYTES;
+            glBindBuffer(GL_ARRAY_BUFFER, eb.buffer);
+            glBufferData(GL_ARRAY_BUFFER, eb.count * VERTEX_BYTES + 2 * paddingBytes, nullptr, GL_STATIC_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, paddingBytes, padding.data());
+            glBufferSubData(GL_ARRAY_BUFFER, paddingBytes, eb.count * VERTEX_BYTES, snapshot.data());
+            glBufferSubData(GL_ARRAY_BUFFER, paddingBytes + eb.count * VERTEX_BYTES, paddingBytes, padding.data());
+            stats.bytesUploaded += eb.count * VERTEX_BYTES;
+            uploaded = true;
+
+            eb.density = !snapshot.density.empty();
+            eb.bounds = snapshot.bounds;
+            if (eb.density) {
+                uploadDensity(eb, snapshot);
+                stats.bytesUploaded += snapshot.density.size();
+            }
 
-        // Draw grid axes on top [0, 4)
-        glLineWidth(2);
-        glDrawArrays(GL_LINES, 0, 4);
+            eb.fillCount = (GLsizei) (snapshot.fill.size() / Equation::FLOATS_PER_VERTEX);
+            if (eb.fillCount > 0) {
+                if (eb.fillBuffer == 0) glGenBuffers(1, &eb.fillBuffer);
+                glBindBuffer(GL_ARRAY_BUFFER, eb.fillBuffer);
+                glBufferData(GL_ARRAY_BUFFER, eb.fillCount * VERTEX_BYTES, snapshot.fill.data(), GL_STATIC_DRAW);
+                stats.bytesUploaded += eb.fillCount * VERTEX_BYTES;
+            }
+        }
+
+        // New geometry for a view change is on screen from this frame
+        const long long request = calculationLoop.getCalculatedRequest();
+        if (uploaded && request != stats.shownRequest) {
+            stats.latency = steadyMillis() - request;
+            stats.shownRequest = request;
+        }
     }
 
+    void GraphView::uploadDensity(EquationBuffer& eb, const Graph::Snapshot& snapshot) {
+        if (eb.texture == 0) {
+            glGenTextures(1, &eb.texture);
+            glBindTexture(GL_TEXTURE_2D, eb.texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
 
-    void GraphView::drawElements() {
-        // Lock the graph's mutex while drawing
-        std::scoped_lock<std::mutex> lock(graph->getMutex());
+        // Single-channel textures need the same versions as instanced lines; older ones use luminance instead
+        const GLint internalFormat = instancedLines ? GL_R8 : GL_LUMINANCE;
+        const GLenum format = instancedLines ? GL_RED : GL_LUMINANCE;
+
+        glBindTexture(GL_TEXTURE_2D, eb.texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, snapshot.densityWidth, snapshot.densityHeight, 0, format,
+                     GL_UNSIGNED_BYTE, snapshot.density.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // Density images are drawn below all lines, each as a quad covering the region it was rendered for
+    void GraphView::drawDensities() {
+        const std::vector<std::shared_ptr<Equation>>& equations = graph->getEquations();
+
+        glUseProgram(densityProgram);
+        glUniformMatrix4fv(glGetUniformLocation(densityProgram, "uProjection"), 1, GL_FALSE, projection.data());
+        glUniform1i(glGetUniformLocation(densityProgram, "uDensity"), 0);
+        const GLint colorLocation = glGetUniformLocation(densityProgram, "uColor");
+        const GLint boundsLocation = glGetUniformLocation(densityProgram, "uBounds");
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindBuffer(GL_ARRAY_BUFFER, gridBuffer);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (void*) (0));
+
+        for (int i = 0; i < equationBuffers.size(); i++) {
+            const EquationBuffer& eb = equationBuffers.at(i);
+            if (!eb.density) continue;
+
+            const Equation::DisplaySettings& ds = equations.at(i)->getDisplaySettings();
+            glUniform4f(colorLocation, ds.r, ds.g, ds.b, ds.a);
+            glUniform4f(boundsLocation, eb.bounds.minX, eb.bounds.maxX, eb.bounds.minY, eb.bounds.maxY);
+            glBindTexture(GL_TEXTURE_2D, eb.texture);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
 
-        unsigned long numVerts;
-        GLsizei count;
-        GLfloat* vertices = graph->getVertexList(numVerts);
+    // Shaded regions are drawn below all lines too, in their equation's colors at a fraction of their opacity
+    void GraphView::drawFills() {
+        const std::vector<std::shared_ptr<Equation>>& equations = graph->getEquations();
 
-        if (numVerts == 0) { return; }
+        glUseProgram(shaderProgram);
+        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "uProjection"), 1, GL_FALSE, projection.data());
+        const GLint colorLocation = glGetUniformLocation(shaderProgram, "uColor");
+
+        const std::vector<Graph::Snapshot>& snapshots = graph->getSnapshots();
+        for (int i = 0; i < equationBuffers.size(); i++) {
+            const EquationBuffer& eb = equationBuffers.at(i);
+            if (eb.fillCount == 0) continue;
+
+            const Equation::DisplaySettings& ds = equations.at(i)->getDisplaySettings();
+            const std::vector<Equation::ColorRun>& runs = snapshots.at(i).fillColors;
+            glBindBuffer(GL_ARRAY_BUFFER, eb.fillBuffer);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, VERTEX_BYTES, (void*) (0));
+            stats.verticesDrawn += eb.fillCount;
+
+            unsigned long first = 0;
+            for (int r = 0; r < std::max(1, (int) runs.size()); r++) {
+                const Equation::ColorRun run = runs.empty() ?
+                        Equation::ColorRun{(unsigned long) eb.fillCount, ds.r, ds.g, ds.b, ds.a} : runs.at(r);
+                glUniform4f(colorLocation, run.r, run.g, run.b, run.a * Equation::FILL_ALPHA);
+                glDrawArrays(GL_TRIANGLES, (GLint) first, (GLsizei) run.count);
+                first += run.count;
+            }
+        }
+    }
+
+    // Drawn with QPainter over the finished frame, so it needs none of the GL state
+    void GraphView::drawOverlay() {
+        const QLocale locale;
+        const QStringList lines = {
+                QString("Frame        %1 ms (%2 fps)").arg(stats.frameMillis, 0, 'f', 1)
+                        .arg(stats.frameInterval > 0 ? 1000 / stats.frameInterval : 0, 0, 'f', 0),
+                QString("Latency      %1 ms").arg(stats.latency),
+                QString("Vertices     %1").arg(locale.toString((qulonglong) stats.verticesDrawn)),
+                QString("Uploaded     %1 KB").arg((double) stats.bytesUploaded / 1024, 0, 'f', 1),
+                QString("Equations    %1 /s").arg(stats.equationRate, 0, 'f', 1),
+                QString("Evaluations  %1 M/s").arg(stats.evaluationRate / 1e6, 0, 'f', 2),
+                QString("Threads      %1 %").arg(100 * stats.utilization, 0, 'f', 0),
+        };
 
-        glLineWidth(2.5f);
+        QPainter painter(this);
+        painter.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        const QFontMetrics metrics = painter.fontMetrics();
 
-        const int batchSize = BATCH_SIZE - (BATCH_SIZE % 2);
+        int width = 0;
+        for (const QString& line: lines) width = std::max(width, metrics.horizontalAdvance(line));
+        const int padding = 8;
+        const QRect box(padding, padding, width + 2 * padding, (int) lines.size() * metrics.height() + 2 * padding);
 
-        while (numVerts > 0) {
-            count = (int) std::fminl(batchSize, numVerts);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, count * VERTEX_BYTES, vertices);
+        painter.fillRect(box, QColor(0, 0, 0, 160));
+        painter.setPen(Qt::white);
+        for (int i = 0; i < lines.size(); i++) {
+            painter.drawText(box.left() + padding, box.top() + padding + i * metrics.height() + metrics.ascent(), lines[i]);
+        }
+    }
 
-            glDrawArrays(GL_LINES, 0, count);
-            vertices += 7 * count;
-            numVerts -= count;
+    // Turns the engine's running totals into rates since the previous sample
+    void GraphView::sampleCounters() {
+        const long long now = steadyMillis();
+        const unsigned long evaluations = Counters::evaluations.load(std::memory_order_relaxed);
+        const unsigned long equations = Counters::equationsCalculated.load(std::memory_order_relaxed);
+        const unsigned long busy = Counters::busyMicros.load(std::memory_order_relaxed);
+        const unsigned long capacity = Counters::capacityMicros.load(std::memory_order_relaxed);
+
+        if (stats.lastSample > 0 && now > stats.lastSample) {
+            const double seconds = (double) (now - stats.lastSample) / 1000;
+            stats.evaluationRate = (double) (evaluations - stats.lastEvaluations) / seconds;
+            stats.equationRate = (double) (equations - stats.lastEquations) / seconds;
+            stats.utilization = capacity > stats.lastCapacity
+                                ? (double) (busy - stats.lastBusy) / (double) (capacity - stats.lastCapacity) : 0;
         }
 
+        stats.lastSample = now;
+        stats.lastEvaluations = evaluations;
+        stats.lastEquations = equations;
+        stats.lastBusy = busy;
+        stats.lastCapacity = capacity;
+    }
+
+
+    // Deletes all equation buffers. Requires a current GL context
+    void GraphView::releaseBuffers() {
+        for (EquationBuffer& eb : equationBuffers) {
+            glDeleteBuffers(1, &eb.buffer);
+            glDeleteBuffers(1, &eb.fillBuffer);
+            glDeleteTextures(1, &eb.texture);
+        }
+        equationBuffers.clear();
+
+        for (const auto& [expression, program] : implicitPrograms) {
+            if (program != 0) glDeleteProgram(program);
+        }
+        implicitPrograms.clear();
     }
 
 
     void GraphView::mousePressEvent(QMouseEvent* event) {
+        // Input would interfere with a replay
+        if (isReplaying()) return;
         dragging = true;
         dragStartPos = event->pos();
         dragStartBounds = graph->getBoundingBox();
@@ -237,15 +784,12 @@ namespace Cubiq {
             graph->setBoundingBox(dragStartBounds.moved(
                     dragStartBounds.width() * (float) (dragStartPos.x() - event->x()) / (float) screenW,
                     dragStartBounds.height() * aspect * (float) (event->y() - dragStartPos.y()) / (float) screenH));
-
-            adjustCamera();
-            calculationThread.markToUpdate();
-            update();
+            viewChanged();
         }
     }
 
     void GraphView::wheelEvent(QWheelEvent* event) {
-        if (dragging) return;
+        if (dragging || isReplaying()) return;
 
         QPoint pixelScroll = event->pixelDelta();
         QPoint angleScroll = event->angleDelta() / 8;
@@ -278,9 +822,15 @@ namespace Cubiq {
                 std::fmaxf(posY + (bounds.maxY - posY) * z, posY + 0.00001f)
         };
         graph->setBoundingBox(newBounds);
+        viewChanged();
+    }
+
+    // Follows a change to the view made by the user
+    void GraphView::viewChanged() {
+        if (recording) recorded.events.push_back({steadyMillis() - recordingStart, graph->getBoundingBox()});
 
         adjustCamera();
-        calculationThread.markToUpdate();
+        calculationLoop.markToUpdate();
         update();
     }
 
@@ -321,29 +871,24 @@ namespace Cubiq {
     }
 
 
-    GLuint GraphView::createShader(const char* vertexSource, const char* fragmentSource, int attribCount, const char* attribs[]) {
+    GLuint GraphView::createShader(const char* vertexSource, const char* fragmentSource, int attribCount, const char* attribs[],
+                                   bool cacheable) {
         initializeOpenGLFunctions();
 
-        // Determine system GLSL version
-        std::string glslVersionStr((char*) glGetString(GL_SHADING_LANGUAGE_VERSION));
-
-        // Convert version string to number compatible with #version directive
-        std::string glslVersionID;
-        for (char c : glslVersionStr) {
-            if (std::isdigit(c)) {
-                glslVersionID += c;
-            } else if (std::isspace(c)) break;
-        }
-
-        // Ensure version does not exceed latest supported version
-        if (std::stoi(glslVersionID, nullptr) > 460)
-            glslVersionID = "460";
+        const std::string preamble = glslPreamble((const char*) glGetString(GL_SHADING_LANGUAGE_VERSION), context()->isOpenGLES());
 
         // Create new source strings with version included
-        std::string vertexSourceStr("#version ");
-        std::string fragmentSourceStr("#version ");
-        vertexSourceStr += glslVersionID + "\n" + vertexSource;
-        fragmentSourceStr += glslVersionID + "\n" + fragmentSource;
+        const std::string vertexSourceStr = preamble + vertexSource;
+        const std::string fragmentSourceStr = preamble + fragmentSource;
+
+        // Programs linked before by the same driver are loaded instead of compiled again
+        const bool cached = programBinaries && cacheable;
+        QString cachePath;
+        if (cached) {
+            cachePath = programCachePath(vertexSourceStr, fragmentSourceStr, attribCount, attribs);
+            GLuint cached = loadProgramBinary(cachePath);
+            if (cached) return cached;
+        }
 
         // Get C-style string source for each shader
         const char* vertexSourceData = vertexSourceStr.data();
@@ -391,6 +936,7 @@ namespace Cubiq {
             glBindAttribLocation(program, i, attribs[i]);
         }
 
+        if (cached) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(program);
 
         glGetProgramiv(program, GL_LINK_STATUS, &status);
@@ -400,6 +946,8 @@ namespace Cubiq {
             glGetProgramInfoLog(program, infoLogLength, NULL, infoLog);
             std::cerr << infoLog << std::endl;
             delete[] infoLog;
+        } else if (cached) {
+            saveProgramBinary(program, cachePath);
         }
 
         // Clean up after ourselves
@@ -409,6 +957,71 @@ namespace Cubiq {
         return program;
     }
 
+    // Binaries are only valid for the driver that produced them, so the driver's strings are part of the key along with
+    // everything that goes into linking
+    QString GraphView::programCachePath(const std::string& vertexSource, const std::string& fragmentSource, int attribCount, const char* attribs[]) {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION}) {
+            hash.addData((const char*) glGetString(name));
+            hash.addData("\n", 1);
+        }
+        hash.addData(vertexSource.data(), (int) vertexSource.size() + 1);
+        hash.addData(fragmentSource.data(), (int) fragmentSource.size() + 1);
+        for (int i = 0; i < attribCount; ++i) {
+            hash.addData(attribs[i], (int) std::strlen(attribs[i]) + 1);
+        }
+
+        const QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shaders";
+        return directory + "/" + QString::fromLatin1(hash.result().toHex()) + ".bin";
+    }
+
+    // Returns 0 if there is no usable binary, e.g. because the driver rejects it after an update
+    GLuint GraphView::loadProgramBinary(const QString& path) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) return 0;
+
+        // Layout: the binary's format, then the binary itself
+        GLenum binaryFormat;
+        const QByteArray data = file.readAll();
+        if (data.size() <= (int) sizeof(binaryFormat)) return 0;
+        std::memcpy(&binaryFormat, data.constData(), sizeof(binaryFormat));
+
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, binaryFormat, data.constData() + sizeof(binaryFormat), (GLsizei) (data.size() - sizeof(binaryFormat)));
+
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status == GL_FALSE) {
+            glDeleteProgram(program);
+            file.remove();
+            return 0;
+        }
+        return program;
+    }
+
+    // Failing to cache a program only costs compiling it again next time, so errors are ignored
+    void GraphView::saveProgramBinary(GLuint program, const QString& path) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        GLenum binaryFormat;
+        QByteArray data(sizeof(binaryFormat) + length, Qt::Uninitialized);
+        glGetProgramBinary(program, length, &length, &binaryFormat, data.data() + sizeof(binaryFormat));
+        if (length <= 0) return;
+        std::memcpy(data.data(), &binaryFormat, sizeof(binaryFormat));
+        data.resize((int) sizeof(binaryFormat) + length);
+
+        QDir dir = QFileInfo(path).absoluteDir();
+        dir.mkpath(".");
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) return;
+
+        // Oldest binaries beyond the cap are deleted
+        const QFileInfoList binaries = dir.entryInfoList({"*.bin"}, QDir::Files, QDir::Time);
+        for (int i = CACHED_PROGRAMS; i < binaries.size(); i++) QFile::remove(binaries[i].absoluteFilePath());
+    }
+
 
     void GraphView::gridStepUp(float& space, int& major) {
         int base = (int) (space / std::pow(10, (int) std::floor(std::log10(space))));
@@ -451,42 +1064,4 @@ namespace Cubiq {
         }
     }
 
-
-    const int GraphView::CalculationThread::MILLIS_PER_UPDATE = 17;
-
-    GraphView::CalculationThread::CalculationThread(GraphView* p, Graph* g) :
-            std::thread(&GraphView::CalculationThread::run, this),
-            parent(p),
-            graph(g),
-            toUpdate(false),
-            toExit(false) {
-
-    }
-
-    void GraphView::CalculationThread::run() {
-        double precision;
-        std::defer_lock_t t;
-        while (!toExit) {
-            if (toUpdate) {
-                precision = 3 * (double) (graph->getBoundingBox().width()) / (double) (parent->screenW);
-                graph->calculateVertices(precision);
-                parent->update();
-                toUpdate = false;
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(MILLIS_PER_UPDATE));
-        }
-    }
-
-    void GraphView::CalculationThread::markToUpdate() {
-        toUpdate = true;
-    }
-
-    void GraphView::CalculationThread::markToExit() {
-        toExit = true;
-    }
-
-    void GraphView::CalculationThread::setGraph(Graph* g) {
-        graph = g;
-    }
-
 }
\ No newline at end of file
@@ -3,9 +3,14 @@
 #include <QOpenGLWidget>
 #include <QOpenGLExtraFunctions>
 #include <QMatrix4x4>
-#include <thread>
+#include <QTimer>
+#include <memory>
+#include <functional>
+#include <unordered_map>
 
 #include "core/graph.h"
+#include "core/calculation_loop.h"
+#include "core/interaction.h"
 
 
 namespace Cubiq {
@@ -13,43 +18,66 @@ namespace Cubiq {
     class GraphView : public QOpenGLWidget, protected QOpenGLExtraFunctions {
 
     private:
-        class CalculationThread : public std::thread {
-
-        public:
-            static const int MILLIS_PER_UPDATE;
-
-            CalculationThread(GraphView* p, Graph* g);
-
-            void markToUpdate();
-
-            void markToExit();
-
-            void setGraph(Graph* g);
-
-        private:
-
-            void run();
+        // Measurements shown by the performance overlay
+        struct OverlayStats {
+            double frameMillis = 0;    // Time spent drawing a frame, smoothed
+            double frameInterval = 0;  // Time between frames, smoothed
+            long long lastFrame = 0;
+            long long latency = 0;     // From a view change to the geometry calculated for it being drawn
+            long long shownRequest = 0;
+            unsigned long verticesDrawn = 0;
+            unsigned long bytesUploaded = 0;
+
+            // Rates of the engine's counters over the last sampling period
+            long long lastSample = 0;
+            unsigned long lastEvaluations = 0, lastEquations = 0, lastBusy = 0, lastCapacity = 0;
+            double evaluationRate = 0, equationRate = 0, utilization = 0;
+        };
 
-            bool toUpdate;
-            bool toExit;
+        // GPU copy of a single equation's geometry
+        struct EquationBuffer {
+            GLuint buffer;
+            GLsizei count;
+            unsigned long revision;
 
-            GraphView* parent;
-            Graph* graph;
+            // Density image, if the equation is drawn as one, and the region it covers
+            GLuint texture;
+            bool density;
+            BoundingBox bounds;
 
+            // Triangles of the region, if the equation shades one
+            GLuint fillBuffer;
+            GLsizei fillCount;
         };
 
 
     public:
-        static const int BATCH_SIZE;
-
         GraphView(QWidget* parent, Graph* g);
         ~GraphView();
 
         void setGraph(Graph* g);
         Graph* getGraph();
 
+        void updateView();
         void centerOrigin();
 
+        void loadSettings();
+
+        bool hasOverlay() const;
+        void setOverlay(bool enabled);
+
+        bool isRecording() const;
+        void startRecording();
+        Interaction stopRecording();
+
+        // Applies the recorded view changes at their recorded times while drawing continuously, then calls done with
+        // the latency report once every change has been drawn
+        bool isReplaying() const;
+        void replay(const Interaction& interaction, std::function<void(QJsonObject)> done);
+
+        BoundingBox getVisibleBounds() const;
+        BoundingBox getVisibleBounds(const BoundingBox& bounds) const;
+
     protected:
         void initializeGL() override;
         void resizeGL(int w, int h) override;
@@ -57,6 +85,17 @@ namespace Cubiq {
 
         void drawGrid();
         void drawElements();
+        void drawDensities();
+        void drawFills();
+        void drawPixelShaded(std::vector<std::string>& failed);
+        GLuint implicitProgram(const std::string& expression, bool region);
+        void pruneImplicitPrograms();
+        void drawOverlay();
+        void sampleCounters();
+        void uploadDensity(EquationBuffer& eb, const Graph::Snapshot& snapshot);
+
+        void uploadSnapshots();
+        void releaseBuffers();
 
         void mousePressEvent(QMouseEvent* event) override;
         void mouseReleaseEvent(QMouseEvent* event) override;
@@ -64,9 +103,18 @@ namespace Cubiq {
         void wheelEvent(QWheelEvent* event) override;
 
         void zoom(float steps, QPointF pos);
+        void viewChanged();
         void adjustCamera();
 
-        GLuint createShader(const char* vertexSource, const char* fragmentSource, int attribCount, const char* attribs[]);
+        void replayFrame();
+        void finishReplay();
+
+        // Only the fixed programs are cacheable, as their number is bounded
+        GLuint createShader(const char* vertexSource, const char* fragmentSource, int attribCount, const char* attribs[],
+                            bool cacheable = true);
+        QString programCachePath(const std::string& vertexSource, const std::string& fragmentSource, int attribCount, const char* attribs[]);
+        GLuint loadProgramBinary(const QString& path);
+        void saveProgramBinary(GLuint program, const QString& path);
 
         static void gridStepUp(float& space, int& major);
         static void gridStepDown(float& space, int& major);
@@ -76,13 +124,22 @@ namespace Cubiq {
         int screenW, screenH;
 
         Graph* graph;
-        CalculationThread calculationThread;
+        CalculationLoop calculationLoop;
 
         QMatrix4x4 projection;
 
         GLuint shaderProgram{};
+        GLuint gridProgram{};
+        GLuint lineProgram{};
+        GLuint densityProgram{};
         GLuint vertexArray{};
-        GLuint vertexBuffer{};
+        GLuint gridBuffer{};
+        GLuint lineQuadBuffer{};
+        bool instancedLines{};
+        bool programBinaries{}; // Whether linked programs can be cached on disk
+        bool pixelShading{}; // Whether equations can be drawn per pixel
+        std::unordered_map<std::string, GLuint> implicitPrograms; // By REGION and expression, 0 if it failed to build
+        std::vector<EquationBuffer> equationBuffers;
 
         QPoint dragStartPos;
         BoundingBox dragStartBounds;
@@ -91,6 +148,21 @@ namespace Cubiq {
         float gridSpaceX, gridSpaceY;
         int gridMajorX, gridMajorY;
 
+        bool overlay;
+        QTimer overlayTimer; // Refreshes the overlay while nothing else is drawn
+        OverlayStats stats;
+
+        bool recording;
+        long long recordingStart;
+        Interaction recorded;
+
+        Interaction replayed;
+        unsigned long replayIndex; // Next event to apply
+        long long replayStart;
+        QTimer replayTimer; // Requests a frame every period while replaying
+        std::unique_ptr<LatencyRecorder> latency;
+        std::function<void(QJsonObject)> replayDone;
+
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "interaction.h"
+
+#include <cmath>
+#include <algorithm>
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+
+
+namespace Cubiq {
+
+    // Each event is stored as [millis, minX, maxX, minY, maxY]
+    bool Interaction::save(const QString& path, QString& error) const {
+        QJsonArray eventArray;
+        for (const Event& event: events) {
+            const BoundingBox& bb = event.bounds;
+            eventArray.append(QJsonArray{(double) event.millis, bb.minX, bb.maxX, bb.minY, bb.maxY});
+        }
+
+        QJsonObject root;
+        root["graph"] = graphPath;
+        root["size"] = QJsonArray{width, height};
+        root["events"] = eventArray;
+
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            error = file.errorString();
+            return false;
+        }
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        if (!file.commit()) {
+            error = file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    bool Interaction::load(const QString& path, Interaction& interaction, QString& error) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = file.errorString();
+            return false;
+        }
+
+        QJsonParseError parseError{};
+        QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+        if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+            error = parseError.error != QJsonParseError::NoError ? parseError.errorString() : "Not a recording";
+            return false;
+        }
+
+        QJsonObject root = document.object();
+        QJsonArray size = root["size"].toArray();
+        interaction.graphPath = root["graph"].toString();
+        interaction.width = size.at(0).toInt();
+        interaction.height = size.at(1).toInt();
+        interaction.events.clear();
+
+        for (const QJsonValue& value: root["events"].toArray()) {
+            QJsonArray event = value.toArray();
+            if (event.size() != 5) {
+                error = "Invalid event";
+                return false;
+            }
+            interaction.events.push_back({(long long) event.at(0).toDouble(), {
+                    (float) event.at(1).toDouble(), (float) event.at(2).toDouble(),
+                    (float) event.at(3).toDouble(), (float) event.at(4).toDouble()}});
+        }
+
+        if (interaction.width <= 0 || interaction.height <= 0 || interaction.events.empty()) {
+            error = "Recording is empty";
+            return false;
+        }
+        return true;
+    }
+
+
+    const double LatencyRecorder::FRAME_MILLIS = 1000.0 / 60; // Frame period the dropped frames are counted against
+    const int LatencyRecorder::TIMEOUT_MILLIS = 5000; // Time after the last input to give up waiting for it to be drawn
+
+    LatencyRecorder::LatencyRecorder(double frameMillis) :
+            frameMillis(frameMillis), inputs(0), frames(0), droppedFrames(0), lastFrame(-1) {}
+
+    void LatencyRecorder::input(unsigned long serial, long long micros) {
+        pending.emplace_back(serial, micros);
+        inputs++;
+    }
+
+    void LatencyRecorder::frame(unsigned long handledSerial, long long micros) {
+        while (!pending.empty() && pending.front().first <= handledSerial) {
+            latencies.push_back((double) (micros - pending.front().second) / 1000);
+            pending.pop_front();
+        }
+
+        // Frames are requested every period, so a longer gap means the ones in between were never drawn
+        if (lastFrame >= 0) {
+            const double periods = (double) (micros - lastFrame) / 1000 / frameMillis;
+            droppedFrames += (unsigned long) std::max(0.0, std::round(periods) - 1);
+        }
+        lastFrame = micros;
+        frames++;
+    }
+
+    bool LatencyRecorder::isSettled() const {
+        return pending.empty();
+    }
+
+    QJsonObject LatencyRecorder::report() const {
+        std::vector<double> sorted = latencies;
+        std::sort(sorted.begin(), sorted.end());
+
+        // Nearest rank
+        auto percentile = [&sorted](double p) {
+            if (sorted.empty()) return 0.0;
+            auto rank = (unsigned long) std::ceil(p / 100 * (double) sorted.size());
+            return sorted[std::clamp(rank, 1ul, (unsigned long) sorted.size()) - 1];
+        };
+
+        QJsonObject latency;
+        latency["p50"] = percentile(50);
+        latency["p95"] = percentile(95);
+        latency["p99"] = percentile(99);
+        latency["max"] = sorted.empty() ? 0.0 : sorted.back();
+
+        // Buckets of up to 1, 2, 4, ... milliseconds, the last one holding everything slower
+        QJsonArray histogram;
+        auto it = sorted.begin();
+        for (double bound = 1; it != sorted.end(); bound *= 2) {
+            auto next = bound >= 4096 ? sorted.end() : std::upper_bound(it, sorted.end(), bound);
+            QJsonObject bucket;
+            bucket["upToMillis"] = bound >= 4096 ? QJsonValue() : QJsonValue(bound);
+            bucket["count"] = (int) (next - it);
+            histogram.append(bucket);
+            it = next;
+        }
+
+        QJsonObject report;
+        report["inputs"] = (double) inputs;
+        report["undrawnInputs"] = (double) pending.size();
+        report["frames"] = (double) frames;
+        report["droppedFrames"] = (double) droppedFrames;
+        report["latencyMillis"] = latency;
+        report["histogram"] = histogram;
+        return report;
+    }
+
+}
\ No newline at end of file
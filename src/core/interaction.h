@@ -0,0 +1,59 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <utility>
+#include <QString>
+#include <QJsonObject>
+
+#include "core/bounding_box.h"
+
+
+namespace Cubiq {
+
+    // The view changes made by panning and zooming, with the times they were made at, so the same session can be
+    // replayed against a graph to measure how quickly geometry follows the input
+    struct Interaction {
+        struct Event {
+            long long millis; // Since recording started
+            BoundingBox bounds;
+        };
+
+        QString graphPath; // Graph the session was recorded on, if it had been saved
+        int width = 0, height = 0; // Size of the view in pixels
+        std::vector<Event> events;
+
+        bool save(const QString& path, QString& error) const;
+        static bool load(const QString& path, Interaction& interaction, QString& error);
+    };
+
+
+    // Measures the latency from each input to the first frame drawn with geometry that accounts for it, and the frames
+    // missed on the way. Inputs and the calculations handling them are identified by increasing serial numbers
+    class LatencyRecorder {
+
+    public:
+        static const double FRAME_MILLIS;
+        static const int TIMEOUT_MILLIS;
+
+        explicit LatencyRecorder(double frameMillis = FRAME_MILLIS);
+
+        void input(unsigned long serial, long long micros);
+        // A frame was drawn with the geometry of every input up to and including handledSerial
+        void frame(unsigned long handledSerial, long long micros);
+
+        bool isSettled() const; // Whether every input so far has been drawn
+
+        // Input count, frames drawn and dropped, latency percentiles and a histogram with power of two buckets
+        QJsonObject report() const;
+
+    private:
+        double frameMillis;
+        std::deque<std::pair<unsigned long, long long>> pending; // Serial and time of inputs not yet drawn
+        std::vector<double> latencies; // Milliseconds
+        unsigned long inputs, frames, droppedFrames;
+        long long lastFrame;
+
+    };
+
+}
\ No newline at end of file
@@ -3,7 +3,9 @@
 #include <iostream>
 
 #include "main_window.h"
+#include "trace.h"
 #include "../equations/function.h"
+#include "../equations/placeholder.h"
 
 
 namespace Cubiq {
@@ -11,7 +13,9 @@ namespace Cubiq {
     MainWindow::MainWindow() :
             graphView(new GraphView(this, new Graph())),
             equationDock(new QDockWidget(tr("Equations"), this)),
-            equationList(new QListWidget(equationDock)) {
+            equationList(new QListWidget(equationDock)),
+            loader(nullptr),
+            replayPending(false) {
         setMinimumSize(800, 600);
         setCentralWidget(graphView);
         setWindowModified(false);
@@ -34,9 +38,10 @@ namespace Cubiq {
 
 
     void MainWindow::createGraphView() {
-        // Enable multisampling
+        // Request a core profile for instanced line drawing. Lines are anti-aliased by their shader, so no multisampling
         QSurfaceFormat format;
-        format.setSamples(4);
+        format.setVersion(3, 3);
+        format.setProfile(QSurfaceFormat::CoreProfile);
         graphView->setFormat(format);
 
         Graph* graph = graphView->getGraph();
@@ -100,6 +105,13 @@ namespace Cubiq {
         QAction* aCut = createAction("cut", "Cut", SLOT(handleCut()), "Ctrl+X", "Cut the current selection to clipboard.");
 
         QAction* aOrigin = createAction("origin", "Return to Origin", SLOT(handleOrigin()), "Ctrl+.", "Center the view on (0, 0).");
+        QAction* aTrace = createAction("trace", "Record Trace", SLOT(handleTrace()), "Ctrl+Alt+T", "Record where time is spent, then save it as a Chrome trace.");
+        aTrace->setCheckable(true);
+        QAction* aOverlay = createAction("overlay", "Performance Overlay", SLOT(handleOverlay()), "Ctrl+Alt+P", "Show how fast the graph is calculated and drawn.");
+        aOverlay->setCheckable(true);
+        QAction* aRecord = createAction("record", "Record Input", SLOT(handleRecord()), "Ctrl+Alt+R", "Record panning and zooming, then save it to replay later.");
+        aRecord->setCheckable(true);
+        QAction* aReplay = createAction("replay", "Replay Input...", SLOT(handleReplay()), "Ctrl+Alt+Y", "Replay recorded input and measure how quickly the graph follows it.");
 
         QAction* aAbout = createAction("about", "About Cubiq...", SLOT(handleAbout()), "", "More information about this program.");
 
@@ -118,6 +130,11 @@ namespace Cubiq {
 
         QMenu* mView = menuBar()->addMenu("View");
         mView->addAction(aOrigin);
+        mView->addSeparator();
+        mView->addAction(aOverlay);
+        mView->addAction(aTrace);
+        mView->addAction(aRecord);
+        mView->addAction(aReplay);
 
         QMenu* mWindow = menuBar()->addMenu("Window");
 
@@ -176,6 +193,10 @@ namespace Cubiq {
 
     void MainWindow::closeEvent(QCloseEvent* event) {
         if (checkUnsavedChanges()) {
+            // Deleting the loader cancels its compile jobs, which are not waited for. Saves still being written are
+            delete loader;
+            loader = nullptr;
+            waitForSaves();
             event->accept();
         } else {
             event->ignore();
@@ -185,30 +206,43 @@ namespace Cubiq {
 
     void MainWindow::handleNew() {
         if (checkUnsavedChanges()) {
+            // The loader must not outlive its graph
+            delete loader;
+            loader = nullptr;
             graphView->setGraph(new Graph());
+            filePath.clear();
+            equationList->clear();
+            equationList->addItem(tr("There's nothing here yet. Divert your eyes."));
             updateInfo();
         }
     }
 
     void MainWindow::handleOpen() {
-        // Open file
+        if (!checkUnsavedChanges()) return;
+        QString path = QFileDialog::getOpenFileName(this, tr("Open Graph"), filePath, tr("Graphs (*.json);;All files (*)"));
+        if (!path.isEmpty()) openGraph(path);
     }
 
     bool MainWindow::handleSave() {
         // Handle saving: true if saved successfully, false if cancelled (i.e. exited Save As)
-        setWindowModified(false);
+        if (filePath.isEmpty()) return handleSaveAs();
+        writeGraph(filePath);
         return true;
     }
 
     bool MainWindow::handleSaveAs() {
         // Open file dialog to save under a filename, true if saved, false if cancelled
-        setWindowModified(false);
+        QString path = QFileDialog::getSaveFileName(this, tr("Save Graph"), filePath, tr("Graphs (*.json)"));
+        if (path.isEmpty()) return false;
+        filePath = path;
+        writeGraph(filePath);
         return true;
     }
 
     void MainWindow::handleSettings() {
         SettingsDialog dialog;
         dialog.exec();
+        graphView->loadSettings();
     }
 
     void MainWindow::handleCopy() {
@@ -223,11 +257,172 @@ namespace Cubiq {
         graphView->centerOrigin();
     }
 
+    void MainWindow::handleOverlay() {
+        graphView->setOverlay(!graphView->hasOverlay());
+    }
+
+    // Starts recording, or stops and saves what was recorded
+    void MainWindow::handleTrace() {
+        if (!Trace::isEnabled()) {
+            Trace::start();
+            return;
+        }
+
+        Trace::stop();
+        QString path = QFileDialog::getSaveFileName(this, tr("Save Trace"), "trace.json", tr("Chrome traces (*.json)"));
+        QString error;
+        if (!path.isEmpty() && !Trace::write(path, error)) {
+            QMessageBox::warning(this, tr("Save Trace"), tr("Could not save the trace: %1").arg(error));
+        }
+    }
+
+    // Starts recording, or stops and saves what was recorded
+    void MainWindow::handleRecord() {
+        if (!graphView->isRecording()) {
+            graphView->startRecording();
+            return;
+        }
+
+        Interaction interaction = graphView->stopRecording();
+        interaction.graphPath = filePath;
+        QString path = QFileDialog::getSaveFileName(this, tr("Save Recording"), "input.json", tr("Recordings (*.json)"));
+        QString error;
+        if (!path.isEmpty() && !interaction.save(path, error)) {
+            QMessageBox::warning(this, tr("Save Recording"), tr("Could not save the recording: %1").arg(error));
+        }
+    }
+
+    // Replays on the current graph, which is what the user is looking at
+    void MainWindow::handleReplay() {
+        if (graphView->isReplaying()) return;
+        QString path = QFileDialog::getOpenFileName(this, tr("Replay Input"), QString(), tr("Recordings (*.json);;All files (*)"));
+        if (path.isEmpty()) return;
+
+        QString error;
+        if (!Interaction::load(path, replayed, error)) {
+            QMessageBox::warning(this, tr("Replay Input"), tr("Could not open the recording: %1").arg(error));
+            return;
+        }
+        replayReportPath.clear();
+        startReplay();
+    }
+
     void MainWindow::handleAbout() {
         // About
     }
 
 
+    // Shows the graph right away and fills it in as the file is read and its elements are compiled
+    void MainWindow::openGraph(const QString& path) {
+        delete loader;
+        loader = new GraphLoader(path, this);
+        connect(loader, &GraphLoader::elementAdded, this, &MainWindow::handleElementAdded);
+        connect(loader, &GraphLoader::elementChanged, this, &MainWindow::handleElementChanged);
+        connect(loader, &GraphLoader::headerLoaded, this, &MainWindow::handleHeaderLoaded);
+        connect(loader, &GraphLoader::finished, this, &MainWindow::handleLoadFinished);
+
+        graphView->setGraph(loader->getGraph());
+        filePath = path;
+        equationList->clear();
+        setWindowModified(false);
+        updateInfo();
+
+        loader->start();
+    }
+
+    // The file is written in the background. The graph is marked unsaved again if that fails
+    void MainWindow::writeGraph(const QString& path) {
+        bool writeCache = QSettings().value("file/geometryCache", true).toBool();
+        saveGraph(graphView->getGraph(), path, writeCache, this, [this](const QString& error) {
+            if (error.isEmpty()) return;
+            setWindowModified(true);
+            QMessageBox::warning(this, tr("Save Graph"), tr("Could not save the graph: %1").arg(error));
+        });
+        setWindowModified(false);
+    }
+
+    void MainWindow::replay(const Interaction& interaction, const QString& reportPath) {
+        replayed = interaction;
+        replayReportPath = reportPath;
+        if (interaction.graphPath.isEmpty()) {
+            startReplay();
+            return;
+        }
+
+        // Started once the graph is loaded, so loading is not measured
+        replayPending = true;
+        openGraph(interaction.graphPath);
+    }
+
+    void MainWindow::startReplay() {
+        replayPending = false;
+        graphView->replay(replayed, [this](const QJsonObject& report) { finishReplay(report); });
+    }
+
+    void MainWindow::finishReplay(const QJsonObject& report) {
+        QByteArray json = QJsonDocument(report).toJson();
+        if (replayReportPath.isEmpty()) {
+            QJsonObject latency = report["latencyMillis"].toObject();
+            QMessageBox box(QMessageBox::Information, tr("Replay Input"), tr(
+                    "Latency from input to geometry: %1 ms median, %2 ms p95, %3 ms p99.\n%4 of %5 frames dropped.")
+                    .arg(latency["p50"].toDouble(), 0, 'f', 1).arg(latency["p95"].toDouble(), 0, 'f', 1)
+                    .arg(latency["p99"].toDouble(), 0, 'f', 1).arg(report["droppedFrames"].toInt())
+                    .arg(report["frames"].toInt() + report["droppedFrames"].toInt()), QMessageBox::Ok, this);
+            box.setDetailedText(QString::fromUtf8(json));
+            box.exec();
+            return;
+        }
+
+        if (replayReportPath == "-") {
+            std::cout << json.toStdString() << std::flush;
+            QCoreApplication::exit(0);
+            return;
+        }
+
+        QSaveFile file(replayReportPath);
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) < 0 || !file.commit()) {
+            qWarning("Could not write the replay report: %s", qPrintable(file.errorString()));
+            QCoreApplication::exit(1);
+            return;
+        }
+        QCoreApplication::exit(0);
+    }
+
+    QString MainWindow::describeElement(int index) {
+        Graph* graph = graphView->getGraph();
+        std::scoped_lock<std::mutex> lock(graph->getMutex());
+        const Equation* equation = graph->getEquations().at(index).get();
+
+        QString text = QString::fromStdString(equation->getSource());
+        if (auto* placeholder = dynamic_cast<const Placeholder*>(equation)) {
+            if (placeholder->getError().empty()) text += tr(" (compiling...)");
+            else text += "\n" + QString::fromStdString(placeholder->getError());
+        }
+        return text;
+    }
+
+    void MainWindow::handleElementAdded(int index) {
+        equationList->addItem(describeElement(index));
+    }
+
+    void MainWindow::handleElementChanged(int index) {
+        equationList->item(index)->setText(describeElement(index));
+    }
+
+    void MainWindow::handleHeaderLoaded() {
+        // The header may include where the graph was last viewed
+        graphView->updateView();
+        updateInfo();
+    }
+
+    void MainWindow::handleLoadFinished(const QString& error) {
+        if (!error.isEmpty()) {
+            QMessageBox::warning(this, tr("Open Graph"), tr("Could not open the graph: %1").arg(error));
+        }
+        if (replayPending) startReplay();
+    }
+
+
     void MainWindow::updateInfo() {
         QString title("[*] - Cubiq Grapher");
         setWindowTitle(title.insert(3, graphView->getGraph()->getName()));
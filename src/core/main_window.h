@@ -5,6 +5,7 @@
 
 #include "core/graph_view.h"
 #include "core/settings_dialog.h"
+#include "core/graph_file.h"
 
 
 namespace Cubiq {
@@ -15,11 +16,22 @@ namespace Cubiq {
     public:
         MainWindow();
 
+        // Replays a recorded session, on the graph it was recorded on if that was saved. The report is written to
+        // reportPath ("-" for the standard output) and the program exits if one is given, otherwise it is shown
+        void replay(const Interaction& interaction, const QString& reportPath = QString());
+
     private:
         GraphView* graphView;
         QDockWidget* equationDock;
         QListWidget* equationList;
 
+        GraphLoader* loader;
+        QString filePath; // Where the graph was last opened from or saved to, if anywhere
+
+        Interaction replayed;
+        QString replayReportPath;
+        bool replayPending; // Waiting for the graph to load
+
         QAction* createAction(const char* name, const char* text, const char* slot, const char* shortcut, const char* toolTip);
 
         void createGraphView();
@@ -28,6 +40,13 @@ namespace Cubiq {
 
         bool checkUnsavedChanges();
 
+        void openGraph(const QString& path);
+        void writeGraph(const QString& path);
+        QString describeElement(int index);
+
+        void startReplay();
+        void finishReplay(const QJsonObject& report);
+
     protected:
         void closeEvent(QCloseEvent* event) override;
 
@@ -43,11 +62,20 @@ namespace Cubiq {
         void handleCut();
 
         void handleOrigin();
+        void handleOverlay();
+        void handleTrace();
+        void handleRecord();
+        void handleReplay();
 
         void handleAbout();
 
         void updateInfo();
 
+        void handleElementAdded(int index);
+        void handleElementChanged(int index);
+        void handleHeaderLoaded();
+        void handleLoadFinished(const QString& error);
+
     };
 
 }
\ No newline at end of file
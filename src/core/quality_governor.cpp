@@ -0,0 +1,58 @@
+#include "quality_governor.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+namespace Cubiq {
+
+    const double QualityGovernor::MAX_SAMPLE_WIDTH = 32;
+
+
+    QualityGovernor::QualityGovernor(double minWidth, double budgetMillis) {
+        configure(minWidth, budgetMillis);
+    }
+
+
+    void QualityGovernor::configure(double minWidth, double budgetMillis) {
+        minSampleWidth = std::clamp(minWidth, 1.0, MAX_SAMPLE_WIDTH);
+        frameBudget = std::max(budgetMillis, 1.0);
+
+        for (double& width : sampleWidths) {
+            width = std::max(width, minSampleWidth);
+        }
+    }
+
+    // Must be called before the sample widths of a new set of equations are requested
+    void QualityGovernor::resize(unsigned long numEquations) {
+        sampleWidths.resize(numEquations, minSampleWidth);
+    }
+
+
+    double QualityGovernor::getSampleWidth(unsigned long index, bool interactive) const {
+        return interactive ? sampleWidths.at(index) : minSampleWidth;
+    }
+
+    // Adapts the sample width of an equation after it took the given time to calculate at the given width.
+    // Safe to call concurrently for different equations
+    void QualityGovernor::record(unsigned long index, double sampleWidth, double millis) {
+        // Each equation gets an equal share of the budget
+        double share = frameBudget / (double) std::max(sampleWidths.size(), 1ul);
+
+        // Assume the worst case of cost growing with the number of samples per area (as for implicit equations), then
+        // move halfway towards the width expected to hit the target to avoid oscillating
+        double target = sampleWidth * std::sqrt(millis / share);
+        double width = 0.5 * (sampleWidths.at(index) + target);
+
+        sampleWidths.at(index) = std::clamp(width, minSampleWidth, MAX_SAMPLE_WIDTH);
+    }
+
+
+    // Whether any equation is currently sampled more coarsely than the minimum during interaction
+    bool QualityGovernor::isReduced() const {
+        return std::any_of(sampleWidths.begin(), sampleWidths.end(), [this](double width) {
+            return width > minSampleWidth;
+        });
+    }
+
+}
\ No newline at end of file
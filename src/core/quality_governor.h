@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+
+namespace Cubiq {
+
+    // Chooses the sample width of each equation, in pixels, so that recalculating during interaction stays within a
+    // time budget. Sample widths adapt to the measured calculation time of each equation, but never go below the
+    // user's chosen minimum. Outside of interaction, equations are always calculated at that minimum.
+    class QualityGovernor {
+
+    public:
+        static const double MAX_SAMPLE_WIDTH;
+
+        QualityGovernor(double minWidth, double budgetMillis);
+
+        void configure(double minWidth, double budgetMillis);
+        void resize(unsigned long numEquations);
+
+        double getSampleWidth(unsigned long index, bool interactive) const;
+        void record(unsigned long index, double sampleWidth, double millis);
+
+        bool isReduced() const;
+
+    private:
+        double minSampleWidth;
+        double frameBudget;
+
+        std::vector<double> sampleWidths;
+
+    };
+
+}
\ No newline at end of file
@@ -25,7 +25,7 @@ namespace Cubiq {
         mainLayout->insertWidget(mainLayout->count() - 1, s##id);
 
 
-    GeneralSettingsPage::GeneralSettingsPage(QSettings& settings) {
+    GeneralSettingsPage::GeneralSettingsPage(QSettings& settings) : cfgGeometryCache(new QCheckBox) {
         PAGE_SETUP
 
         // Test code taken from official Qt website
@@ -48,15 +48,21 @@ namespace Cubiq {
         configGroup->setLayout(configLayout);
 
         mainLayout->insertWidget(0, configGroup);
+
+        MAKE_SECTION(Files, "Files")
+
+        cfgGeometryCache->setChecked(settings.value("file/geometryCache", true).toBool());
+        cfgGeometryCache->setToolTip(tr("Saves calculated geometry next to the graph, so it is drawn instantly when reopened."));
+        lFiles->addRow("Save geometry cache:", cfgGeometryCache);
     }
 
     void GeneralSettingsPage::saveSettings(QSettings& settings) {
-        // Nothing to save yet
+        settings.setValue("file/geometryCache", cfgGeometryCache->isChecked());
     }
 
 
     DisplaySettingsPage::DisplaySettingsPage(QSettings& settings) :
-            cfgSampleWidth(new QSpinBox) {
+            cfgSampleWidth(new QSpinBox), cfgFrameBudget(new QSpinBox) {
         PAGE_SETUP
 
         MAKE_SECTION(Advanced, "Advanced")
@@ -65,10 +71,17 @@ namespace Cubiq {
         cfgSampleWidth->setRange(1, 20);
         cfgSampleWidth->setSuffix(" px");
         lAdvanced->addRow("Function sample width:", cfgSampleWidth);
+
+        cfgFrameBudget->setRange(5, 200);
+        cfgFrameBudget->setValue(settings.value("display/frameBudget", 16).toInt());
+        cfgFrameBudget->setSuffix(" ms");
+        cfgFrameBudget->setToolTip(tr("While panning and zooming, sample width is increased to stay within this time."));
+        lAdvanced->addRow("Frame time budget:", cfgFrameBudget);
     }
 
     void DisplaySettingsPage::saveSettings(QSettings& settings) {
         settings.setValue("display/sampleWidth", cfgSampleWidth->value());
+        settings.setValue("display/frameBudget", cfgFrameBudget->value());
     }
 
 
@@ -9,6 +9,7 @@ class QListWidget;
 class QListWidgetItem;
 class QStackedWidget;
 class QSpinBox;
+class QCheckBox;
 
 
 namespace Cubiq {
@@ -30,6 +31,9 @@ namespace Cubiq {
 
         void saveSettings(QSettings& settings);
 
+    private:
+        QCheckBox* cfgGeometryCache;
+
     };
 
 
@@ -43,6 +47,7 @@ namespace Cubiq {
 
     private:
         QSpinBox* cfgSampleWidth;
+        QSpinBox* cfgFrameBudget;
 
     };
 
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "core/bounding_box.h"
+
+
+namespace Cubiq {
+
+    class GeometryCache;
+
+    // Number of consecutive vertices drawn in a color
+    struct ColorRun {
+        unsigned long count;
+        float r, g, b, a;
+    };
+
+    // Geometry most recently calculated for a single equation. Vertices are in graph coordinates, so a snapshot can be
+    // drawn with any projection until it is replaced, even if the view has since changed. What an equation writes into
+    // it decides how it is drawn: segments, optionally with triangles and runs of color, or a density image
+    struct Snapshot {
+        std::vector<float> vertices;
+        BoundingBox bounds;
+        double precision;
+        unsigned long revision;
+
+        // Geometry read from a cache file is used in place, and keeps the file mapped
+        std::shared_ptr<const GeometryCache> cache;
+        const float* mappedVertices = nullptr;
+        unsigned long numMappedFloats = 0;
+
+        // Density image covering the bounds instead, for equations drawn that way
+        std::vector<unsigned char> density;
+        int densityWidth = 0, densityHeight = 0;
+
+        // Triangles shading the region of equations that fill one, drawn below the segments
+        std::vector<float> fill;
+
+        // Runs of the segments and of the triangles in each color, for equations drawn in several. Empty if
+        // everything is in the equation's color
+        std::vector<ColorRun> colors, fillColors;
+
+        const float* data() const { return cache ? mappedVertices : vertices.data(); }
+        unsigned long size() const { return cache ? numMappedFloats : vertices.size(); }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "trace.h"
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <QSaveFile>
+
+
+namespace Cubiq {
+
+    const unsigned long Trace::EVENTS_PER_THREAD = 1 << 15; // Older events are overwritten
+
+    std::atomic<bool> Trace::enabled = false;
+
+    namespace {
+
+        // Fields are atomic so the writer can overwrite an event while it is being read, which the reader detects
+        struct Event {
+            std::atomic<const char*> name;
+            std::atomic<long long> start;
+            std::atomic<long long> end;
+        };
+
+        struct ThreadBuffer {
+            int threadId;
+            std::unique_ptr<Event[]> events;
+            std::atomic<unsigned long> head; // Number of events ever recorded
+        };
+
+        // Buffers are created on a thread's first event and kept for the rest of the program, since the thread may
+        // be a pool thread that keeps running anyway
+        std::mutex registryMutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        std::vector<std::pair<int, std::string>> threadNames;
+        long long startTime = 0;
+
+        std::atomic<int> nextThreadId = 1;
+        thread_local int threadId = 0;
+        thread_local ThreadBuffer* threadBuffer = nullptr;
+
+        int currentThreadId() {
+            if (threadId == 0) threadId = nextThreadId++;
+            return threadId;
+        }
+
+        ThreadBuffer* currentBuffer() {
+            if (!threadBuffer) {
+                auto buffer = std::make_unique<ThreadBuffer>();
+                buffer->threadId = currentThreadId();
+                buffer->events = std::make_unique<Event[]>(Trace::EVENTS_PER_THREAD);
+                buffer->head = 0;
+
+                std::scoped_lock<std::mutex> lock(registryMutex);
+                threadBuffer = buffer.get();
+                buffers.push_back(std::move(buffer));
+            }
+            return threadBuffer;
+        }
+
+        void appendEscaped(std::string& json, const char* text) {
+            for (const char* c = text; *c; c++) {
+                if (*c == '"' || *c == '\\') json += '\\';
+                json += *c;
+            }
+        }
+
+    }
+
+
+    void Trace::start() {
+        {
+            std::scoped_lock<std::mutex> lock(registryMutex);
+            startTime = now();
+        }
+        enabled = true;
+    }
+
+    void Trace::stop() {
+        enabled = false;
+    }
+
+    void Trace::nameThread(const char* name) {
+        const int id = currentThreadId();
+        std::scoped_lock<std::mutex> lock(registryMutex);
+        threadNames.emplace_back(id, name);
+    }
+
+    long long Trace::now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void Trace::record(const char* name, long long start, long long end) {
+        ThreadBuffer* buffer = currentBuffer();
+        const unsigned long index = buffer->head.load(std::memory_order_relaxed);
+        Event& event = buffer->events[index % EVENTS_PER_THREAD];
+        // Pairs with the fence in write, so a reader that sees any of these stores also sees head at least at index
+        std::atomic_thread_fence(std::memory_order_release);
+        event.name.store(name, std::memory_order_relaxed);
+        event.start.store(start, std::memory_order_relaxed);
+        event.end.store(end, std::memory_order_relaxed);
+        buffer->head.store(index + 1, std::memory_order_release);
+    }
+
+
+    bool Trace::write(const QString& path, QString& error) {
+        std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        auto beginEvent = [&json, &first]() {
+            if (!first) json += ",\n";
+            first = false;
+        };
+
+        {
+            std::scoped_lock<std::mutex> lock(registryMutex);
+            for (const auto& [id, name]: threadNames) {
+                beginEvent();
+                json += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + std::to_string(id) + ",\"args\":{\"name\":\"";
+                appendEscaped(json, name.c_str());
+                json += "\"}}";
+            }
+
+            for (const auto& buffer: buffers) {
+                const unsigned long head = buffer->head.load(std::memory_order_acquire);
+                // The slot after the newest event is the next one to be overwritten, so it is not read at all
+                const unsigned long oldest = head >= EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD + 1 : 0;
+
+                struct Copy {
+                    const char* name;
+                    long long start, end;
+                };
+                std::vector<Copy> copies;
+                for (unsigned long i = oldest; i < head; i++) {
+                    const Event& event = buffer->events[i % EVENTS_PER_THREAD];
+                    copies.push_back({event.name.load(std::memory_order_relaxed), event.start.load(std::memory_order_relaxed),
+                                      event.end.load(std::memory_order_relaxed)});
+                }
+
+                // Events the thread may have started overwriting while they were copied are dropped. The fence orders
+                // the copies before the load, so a copy holding part of a newer event is always caught
+                std::atomic_thread_fence(std::memory_order_acquire);
+                const unsigned long headAfter = buffer->head.load(std::memory_order_relaxed);
+                for (unsigned long i = oldest; i < head; i++) {
+                    const Copy& event = copies[i - oldest];
+                    if (i + EVENTS_PER_THREAD <= headAfter || event.start < startTime) continue;
+
+                    beginEvent();
+                    json += "{\"ph\":\"X\",\"name\":\"";
+                    appendEscaped(json, event.name);
+                    json += "\",\"pid\":1,\"tid\":" + std::to_string(buffer->threadId) + ",\"ts\":" +
+                            std::to_string(event.start - startTime) + ",\"dur\":" + std::to_string(event.end - event.start) + "}";
+                }
+            }
+        }
+        json += "]}\n";
+
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            error = file.errorString();
+            return false;
+        }
+        file.write(json.data(), (qint64) json.size());
+        if (!file.commit()) {
+            error = file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <QString>
+
+
+namespace Cubiq {
+
+    // Records spans of time on any thread, to be viewed as a Chrome trace (chrome://tracing or Perfetto). Each thread
+    // writes into a ring buffer of its own without locking, and the buffers are only read when the trace is written.
+    // While tracing is stopped, a span costs a single relaxed load, so spans stay compiled into every build
+    class Trace {
+
+    public:
+        static const unsigned long EVENTS_PER_THREAD;
+
+        static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+        // Starting discards the events recorded so far
+        static void start();
+        static void stop();
+        // Writes the events recorded since the trace was started, from every thread
+        static bool write(const QString& path, QString& error);
+
+        // Names the calling thread in the trace
+        static void nameThread(const char* name);
+
+        // Microseconds on a steady clock
+        static long long now();
+        // The name must outlive the trace, e.g. a string literal
+        static void record(const char* name, long long start, long long end);
+
+    private:
+        static std::atomic<bool> enabled;
+
+    };
+
+
+    // Records the time from its construction to its destruction, if tracing was enabled when constructed
+    class TraceSpan {
+
+    public:
+        explicit TraceSpan(const char* name) : name(Trace::isEnabled() ? name : nullptr), start(0) {
+            if (this->name) start = Trace::now();
+        }
+
+        ~TraceSpan() {
+            if (name) Trace::record(name, start, Trace::now());
+        }
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+    private:
+        const char* name;
+        long long start;
+
+    };
+
+}
\ No newline at end of file
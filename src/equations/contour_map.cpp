@@ -0,0 +1,305 @@
+#include "contour_map.h"
+
+#include <cmath>
+#include <utility>
+#include <algorithm>
+#include <omp.h>
+
+
+namespace Cubiq {
+
+    namespace {
+
+        // Colors of the lowest to the highest level, bright enough to stand out from the background
+        const float RAMP[][3] = {
+                {0.25f, 0.40f, 0.90f},
+                {0.20f, 0.75f, 0.85f},
+                {0.30f, 0.80f, 0.30f},
+                {0.90f, 0.80f, 0.20f},
+                {0.85f, 0.30f, 0.30f},
+        };
+        const int RAMP_SIZE = sizeof(RAMP) / sizeof(RAMP[0]);
+
+        struct Corner {
+            float x, y, value;
+        };
+
+        // Point where the value reaches the level between two corners. Edges shared by neighbouring cells are always
+        // interpolated in the same direction, so both cells get exactly the same point
+        Corner crossing(const Corner& from, const Corner& to, float level) {
+            const bool flip = to.y < from.y || (to.y == from.y && to.x < from.x);
+            const Corner& a = flip ? to : from;
+            const Corner& b = flip ? from : to;
+            float t = (level - a.value) / (b.value - a.value);
+            if (!(t >= 0 && t <= 1)) t = 0.5f;
+            return {a.x + t * (b.x - a.x), a.y + t * (b.y - a.y), level};
+        }
+
+        void addVertex(std::vector<float>& out, const Corner& c) {
+            out.push_back(c.x);
+            out.push_back(c.y);
+        }
+
+        // Appends the segment where the value crosses the level through a convex polygon, if it does. Values are
+        // interpolated linearly along each edge, so only polygons where the value is linear have a single segment
+        void contour(const Corner* polygon, int numCorners, float level, std::vector<float>& out) {
+            Corner points[2];
+            int numPoints = 0;
+            for (int i = 0; i < numCorners && numPoints < 2; i++) {
+                const Corner& a = polygon[i];
+                const Corner& b = polygon[(i + 1) % numCorners];
+                if ((a.value < level) != (b.value < level)) points[numPoints++] = crossing(a, b, level);
+            }
+
+            if (numPoints == 2) {
+                addVertex(out, points[0]);
+                addVertex(out, points[1]);
+            }
+        }
+
+        // Keeps the part of a convex polygon where the value is at least the threshold, or where it is below it
+        int clip(const Corner* in, int numIn, float threshold, bool above, Corner* out) {
+            auto keep = [threshold, above](const Corner& c) {
+                return above ? c.value >= threshold : c.value < threshold;
+            };
+
+            int numOut = 0;
+            for (int i = 0; i < numIn; i++) {
+                const Corner& a = in[i];
+                const Corner& b = in[(i + 1) % numIn];
+                if (keep(a)) out[numOut++] = a;
+                if (keep(a) != keep(b)) out[numOut++] = crossing(a, b, threshold);
+            }
+            return numOut;
+        }
+
+        // Appends the part of a convex polygon where the value is from the bottom up to the top, as a fan of triangles
+        void fillBand(const Corner* polygon, int numCorners, float bottom, float top, std::vector<float>& out) {
+            // Each cut adds at most one point per edge
+            Corner aboveBottom[8], band[16];
+            int numPoints = clip(polygon, numCorners, bottom, true, aboveBottom);
+            numPoints = clip(aboveBottom, numPoints, top, false, band);
+            for (int p = 1; p + 1 < numPoints; p++) {
+                addVertex(out, band[0]);
+                addVertex(out, band[p]);
+                addVertex(out, band[p + 1]);
+            }
+        }
+
+        void addQuad(std::vector<float>& out, float l, float r, float b, float t) {
+            addVertex(out, {l, b}); addVertex(out, {r, b}); addVertex(out, {r, t});
+            addVertex(out, {l, b}); addVertex(out, {r, t}); addVertex(out, {l, t});
+        }
+
+    }
+
+
+    const int ContourMap::MAX_LEVELS = 256; // Most levels a graph file may ask for
+
+    float ContourMap::Levels::at(int index) const {
+        return count > 1 ? from + (to - from) * (float) index / (float) (count - 1) : from;
+    }
+
+    ContourMap::ContourMap(DisplaySettings settings, std::function<float(float, float)> func, Levels levels, bool heatmap) :
+            ImplicitEquation(settings, std::move(func)), levels(levels), heatmap(heatmap) {}
+
+    const ContourMap::Levels& ContourMap::getLevels() const {
+        return levels;
+    }
+
+    bool ContourMap::hasHeatmap() const {
+        return heatmap;
+    }
+
+    unsigned long ContourMap::getNumVertices(BoundingBox boundingBox, double precision) const {
+        return std::max(0, levels.count) * ImplicitEquation::getNumVertices(boundingBox, precision);
+    }
+
+    unsigned long ContourMap::writeVertices(float* vertices, BoundingBox boundingBox, double precision) const {
+        ValueGrid grid(boundingBox, precision);
+        if (grid.isEmpty() || levels.count <= 0) { return 0; }
+        grid.evaluate(function);
+
+        std::vector<std::vector<float>> lines;
+        writeLevels(grid, lines, nullptr);
+        float* end = vertices;
+        for (const std::vector<float>& level : lines) end = std::copy(level.begin(), level.end(), end);
+        return (end - vertices) / FLOATS_PER_VERTEX;
+    }
+
+    std::string ContourMap::getTypeName() const {
+        return "contour";
+    }
+
+    // Each level and band is a run of its own color. The geometry is not decimated, as that would not keep the runs apart
+    void ContourMap::writeGeometry(Snapshot& snapshot, BoundingBox region, double precision, double pixelSize) const {
+        std::vector<float>& triangles = snapshot.fill;
+        std::vector<float>& segments = snapshot.vertices;
+        std::vector<ColorRun>& triangleColors = snapshot.fillColors;
+        std::vector<ColorRun>& segmentColors = snapshot.colors;
+        triangles.clear();
+        triangleColors.clear();
+        segments.clear();
+        segmentColors.clear();
+
+        ValueGrid grid(region, precision);
+        if (grid.isEmpty() || levels.count <= 0) return;
+        grid.evaluate(function);
+
+        std::vector<std::vector<float>> lines, bands;
+        writeLevels(grid, lines, heatmap ? &bands : nullptr);
+
+        for (int i = 0; i < bands.size(); i++) {
+            triangles.insert(triangles.end(), bands[i].begin(), bands[i].end());
+            triangleColors.push_back(color(((float) i + 0.5f) / (float) bands.size(), bands[i].size() / FLOATS_PER_VERTEX));
+        }
+        for (int i = 0; i < lines.size(); i++) {
+            segments.insert(segments.end(), lines[i].begin(), lines[i].end());
+            const float position = lines.size() > 1 ? (float) i / (float) (lines.size() - 1) : 0;
+            segmentColors.push_back(color(position, lines[i].size() / FLOATS_PER_VERTEX));
+        }
+    }
+
+    Equation::ColorRun ContourMap::color(float position, unsigned long count) const {
+        const float scaled = std::clamp(position, 0.0f, 1.0f) * (RAMP_SIZE - 1);
+        const int stop = std::min((int) scaled, RAMP_SIZE - 2);
+        const float t = scaled - (float) stop;
+
+        const float* a = RAMP[stop];
+        const float* b = RAMP[stop + 1];
+        return {count, a[0] + t * (b[0] - a[0]), a[1] + t * (b[1] - a[1]), a[2] + t * (b[2] - a[2]), displaySettings.a};
+    }
+
+    // Levels that may lie between two values. Only a guess at the edges, so each level still needs checking
+    void ContourMap::levelRange(float low, float high, int& first, int& last) const {
+        const float step = levels.count > 1 ? (levels.to - levels.from) / (float) (levels.count - 1) : 0;
+        if (step == 0) {
+            first = 0;
+            last = levels.count - 1;
+            return;
+        }
+
+        float a = (low - levels.from) / step, b = (high - levels.from) / step;
+        if (a > b) std::swap(a, b);
+        first = (int) std::floor(std::clamp(a, -1.0f, (float) levels.count));
+        last = (int) std::ceil(std::clamp(b, -1.0f, (float) levels.count));
+        first = std::max(first, 0);
+        last = std::min(last, levels.count - 1);
+    }
+
+    // Band i is where the value is from level i up to level i + 1, and is shaded like an inequality: cells entirely
+    // within it are merged into one quad per run along each row, and the rest are clipped to it. Cells where the value
+    // is undefined at any corner are left out
+    void ContourMap::writeLevels(const ValueGrid& grid, std::vector<std::vector<float>>& lines,
+                                 std::vector<std::vector<float>>* bands) const {
+        const int numLevels = levels.count;
+        const int numBands = bands ? std::max(0, numLevels - 1) : 0;
+        const int numThreads = Equation::getNumThreads();
+
+        // Each thread collects its rows' geometry by level, merged once every row is done
+        std::vector<std::vector<std::vector<float>>> threadLines(numThreads, std::vector<std::vector<float>>(numLevels));
+        std::vector<std::vector<std::vector<float>>> threadBands(numThreads, std::vector<std::vector<float>>(numBands));
+
+        #pragma omp parallel num_threads(numThreads) shared(grid, numLevels, numBands, threadLines, threadBands) default(none)
+        {
+            std::vector<std::vector<float>>& outLines = threadLines.at(omp_get_thread_num());
+            std::vector<std::vector<float>>& outBands = threadBands.at(omp_get_thread_num());
+
+            #pragma omp for schedule(static)
+            for (int y = 0; y < grid.getHeight(); y++) {
+                const float b = grid.y(y), t = grid.y(y + 1);
+                int runStart = -1, runBand = -1; // Current run of cells entirely within one band
+
+                for (int x = 0; x <= grid.getWidth(); x++) {
+                    Corner cell[4];
+                    bool defined = false;
+                    float low = 0, high = 0;
+                    if (x < grid.getWidth()) {
+                        const float l = grid.x(x), r = grid.x(x + 1);
+                        cell[0] = {l, b, grid.at(x, y)};
+                        cell[1] = {r, b, grid.at(x + 1, y)};
+                        cell[2] = {r, t, grid.at(x + 1, y + 1)};
+                        cell[3] = {l, t, grid.at(x, y + 1)};
+                        low = std::min({cell[0].value, cell[1].value, cell[2].value, cell[3].value});
+                        high = std::max({cell[0].value, cell[1].value, cell[2].value, cell[3].value});
+                        defined = !std::isnan(cell[0].value) && !std::isnan(cell[1].value) &&
+                                  !std::isnan(cell[2].value) && !std::isnan(cell[3].value);
+                    }
+
+                    int first = 0, last = -1;
+                    if (defined) levelRange(low, high, first, last);
+
+                    // A level between the values on one diagonal and those on the other leaves the cell ambiguous.
+                    // Such cells are split into four triangles meeting at the center, evaluated there, and both the
+                    // lines and the bands are taken from the triangles, so they always agree
+                    const float gapBottom = std::min(std::max(cell[0].value, cell[2].value),
+                                                     std::max(cell[1].value, cell[3].value));
+                    const float gapTop = std::max(std::min(cell[0].value, cell[2].value),
+                                                  std::min(cell[1].value, cell[3].value));
+                    bool saddle = false;
+                    for (int i = first; i <= last && !saddle; i++) {
+                        const float level = levels.at(i);
+                        saddle = gapBottom < level && level <= gapTop;
+                    }
+
+                    Corner triangles[4][3];
+                    if (saddle) {
+                        Corner center{(cell[0].x + cell[2].x) / 2, (cell[0].y + cell[2].y) / 2, 0};
+                        center.value = function(center.x, center.y);
+                        if (std::isnan(center.value)) {
+                            center.value = (cell[0].value + cell[1].value + cell[2].value + cell[3].value) / 4;
+                        }
+                        for (int c = 0; c < 4; c++) {
+                            triangles[c][0] = cell[c];
+                            triangles[c][1] = cell[(c + 1) % 4];
+                            triangles[c][2] = center;
+                        }
+                    }
+
+                    // A level crosses the cell if some corners are below it and the others are not
+                    for (int i = first; i <= last; i++) {
+                        const float level = levels.at(i);
+                        if (!(low < level && level <= high)) continue;
+                        if (!saddle) contour(cell, 4, level, outLines[i]);
+                        for (int c = 0; saddle && c < 4; c++) contour(triangles[c], 3, level, outLines[i]);
+                    }
+
+                    // Bands either side of the levels in the cell may overlap it too
+                    int fullBand = -1;
+                    const int firstBand = std::max(first - 1, 0), lastBand = std::min(last, numBands - 1);
+                    for (int i = firstBand; defined && i <= lastBand; i++) {
+                        const float bottom = std::min(levels.at(i), levels.at(i + 1));
+                        const float top = std::max(levels.at(i), levels.at(i + 1));
+                        if (low >= bottom && high < top) fullBand = i;
+                    }
+
+                    if (fullBand >= 0 && fullBand == runBand) continue;
+                    if (runStart >= 0) addQuad(outBands[runBand], grid.x(runStart), grid.x(x), b, t);
+                    runStart = fullBand >= 0 ? x : -1;
+                    runBand = fullBand;
+                    if (fullBand >= 0) continue;
+
+                    for (int i = firstBand; defined && i <= lastBand; i++) {
+                        const float bottom = std::min(levels.at(i), levels.at(i + 1));
+                        const float top = std::max(levels.at(i), levels.at(i + 1));
+                        if (high < bottom || low >= top) continue;
+
+                        if (!saddle) fillBand(cell, 4, bottom, top, outBands[i]);
+                        for (int c = 0; saddle && c < 4; c++) fillBand(triangles[c], 3, bottom, top, outBands[i]);
+                    }
+                }
+            }
+        }
+
+        lines.assign(numLevels, {});
+        for (int i = 0; i < numLevels; i++) {
+            for (const auto& thread : threadLines) lines[i].insert(lines[i].end(), thread[i].begin(), thread[i].end());
+        }
+        if (!bands) return;
+        bands->assign(numBands, {});
+        for (int i = 0; i < numBands; i++) {
+            for (const auto& thread : threadBands) (*bands)[i].insert((*bands)[i].end(), thread[i].begin(), thread[i].end());
+        }
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "implicit_equation.h"
+
+
+namespace Cubiq {
+
+    // Contours of apply(x,y) at evenly spaced levels, each in its own color, optionally over a heatmap shading the
+    // bands between them. The grid is evaluated once for all levels, and each cell is then visited once, only for the
+    // levels its values span, so a map of many levels costs little more than a single implicit equation
+    class ContourMap : public ImplicitEquation {
+
+    public:
+        struct Levels {
+            float from = -5, to = 5;
+            int count = 11;
+
+            float at(int index) const;
+        };
+
+        static const int MAX_LEVELS;
+
+        ContourMap(DisplaySettings settings, std::function<float(float, float)> func, Levels levels, bool heatmap);
+
+        const Levels& getLevels() const;
+        bool hasHeatmap() const;
+
+        // All levels in the equation's color
+        unsigned long getNumVertices(BoundingBox boundingBox, double precision) const override;
+        unsigned long writeVertices(float* vertices, BoundingBox boundingBox, double precision) const override;
+
+        std::string getTypeName() const override;
+        void writeGeometry(Snapshot& snapshot, BoundingBox region, double precision, double pixelSize) const override;
+
+    private:
+        Levels levels;
+        bool heatmap;
+
+        ColorRun color(float position, unsigned long count) const; // Position from 0 at the lowest level to 1
+
+        // Segments of each level, and triangles of each band between consecutive levels if bands is given
+        void writeLevels(const ValueGrid& grid, std::vector<std::vector<float>>& lines,
+                         std::vector<std::vector<float>>* bands) const;
+        void levelRange(float low, float high, int& first, int& last) const;
+
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,314 @@
+#include "data_table.h"
+
+#include <cmath>
+#include <charconv>
+#include <algorithm>
+#include <numeric>
+#include <ranges>
+
+
+namespace Cubiq {
+
+    const int DataTable::MAX_DENSITY_SIZE = 4096; // Largest width or height of a density image
+
+    DataTable::DataTable(const QString& path, Columns columns, Style style, DisplaySettings settings) :
+            Equation(settings), file(path), mapping(nullptr), samples(nullptr), numSamples(0), stride(2), xOffset(0),
+            yOffset(1), columns(columns), style(style) {}
+
+    DataTable::~DataTable() {
+        if (mapping) file.unmap(mapping);
+    }
+
+    DataTable* DataTable::load(const QString& path, Columns columns, Style style, DisplaySettings settings, std::string& error) {
+        if (columns.x < 0 || columns.y < 0) {
+            error = "Invalid column";
+            return nullptr;
+        }
+
+        auto* table = new DataTable(path, columns, style, settings);
+        if (!table->file.open(QIODevice::ReadOnly)) {
+            error = table->file.errorString().toStdString();
+            delete table;
+            return nullptr;
+        }
+
+        bool loaded = path.endsWith(".csv", Qt::CaseInsensitive) ? table->loadCSV(error) : table->loadBinary(error);
+        if (!loaded) {
+            delete table;
+            return nullptr;
+        }
+
+        if (!table->sortSamples(error)) {
+            delete table;
+            return nullptr;
+        }
+        table->buildPyramid();
+        return table;
+    }
+
+
+    // Parses the two columns into memory. Rows that do not have both as numbers, such as headers, are skipped
+    bool DataTable::loadCSV(std::string& error) {
+        const qint64 size = file.size();
+        const char* text = size > 0 ? (const char*) file.map(0, size) : nullptr;
+        if (!text) {
+            error = size > 0 ? file.errorString().toStdString() : "File is empty";
+            return false;
+        }
+
+        const int numColumns = std::max(columns.x, columns.y) + 1;
+        std::vector<float> row(numColumns);
+
+        const char* end = text + size;
+        for (const char* line = text; line < end;) {
+            const char* lineEnd = std::find(line, end, '\n');
+
+            int column = 0;
+            const char* c = line;
+            while (column < numColumns && c < lineEnd) {
+                while (c < lineEnd && (*c == ' ' || *c == '\t' || *c == '\r')) c++;
+                auto [next, ec] = std::from_chars(c, lineEnd, row[column]);
+                if (ec != std::errc()) break;
+                column++;
+
+                c = next;
+                while (c < lineEnd && (*c == ' ' || *c == '\t' || *c == '\r')) c++;
+                if (c < lineEnd && (*c == ',' || *c == ';')) c++;
+            }
+
+            if (column == numColumns) {
+                ownedSamples.push_back(row[columns.x]);
+                ownedSamples.push_back(row[columns.y]);
+            }
+            line = lineEnd + 1;
+        }
+
+        // The text is not needed once parsed
+        file.unmap((uchar*) text);
+        file.close();
+
+        samples = ownedSamples.data();
+        numSamples = ownedSamples.size() / 2;
+        if (numSamples == 0) {
+            error = "No numeric rows";
+            return false;
+        }
+        return true;
+    }
+
+    // Uses the rows directly from the mapping
+    bool DataTable::loadBinary(std::string& error) {
+        if (columns.count <= std::max(columns.x, columns.y)) {
+            error = "Column out of range";
+            return false;
+        }
+
+        const qint64 rowBytes = (qint64) (columns.count * sizeof(float));
+        numSamples = file.size() / rowBytes;
+        mapping = numSamples > 0 ? file.map(0, (qint64) numSamples * rowBytes) : nullptr;
+        if (!mapping) {
+            error = numSamples > 0 ? file.errorString().toStdString() : "File is empty";
+            return false;
+        }
+
+        samples = (const float*) mapping;
+        stride = columns.count;
+        xOffset = columns.x;
+        yOffset = columns.y;
+        return true;
+    }
+
+    // Regions are looked up by binary search on x, so samples are sorted by x into memory if they are not already.
+    // Rows without an x cannot be placed and are dropped, which also keeps the order strict for sorting. Either is
+    // reported, as the line is then not drawn in the order of the file
+    bool DataTable::sortSamples(std::string& error) {
+        unsigned long numMissing = 0;
+        bool sorted = true;
+        float lastX = -INFINITY;
+        for (unsigned long i = 0; i < numSamples; i++) {
+            if (std::isnan(x(i))) {
+                numMissing++;
+                continue;
+            }
+            sorted = sorted && lastX <= x(i);
+            lastX = x(i);
+        }
+        if (sorted && numMissing == 0) return true;
+        if (numMissing == numSamples) {
+            error = "No rows with an x value";
+            return false;
+        }
+
+        std::vector<unsigned long> order;
+        order.reserve(numSamples - numMissing);
+        for (unsigned long i = 0; i < numSamples; i++) {
+            if (!std::isnan(x(i))) order.push_back(i);
+        }
+        if (!sorted) {
+            std::stable_sort(order.begin(), order.end(),
+                             [this](unsigned long a, unsigned long b) { return x(a) < x(b); });
+        }
+
+        const QString name = file.fileName();
+        if (numMissing > 0) qWarning("%s: dropped %lu rows without an x value", qPrintable(name), numMissing);
+        if (!sorted) qWarning("%s: rows are not in order of x, so they are drawn sorted by x", qPrintable(name));
+
+        numSamples = order.size();
+        std::vector<float> sortedSamples(2 * numSamples);
+        for (unsigned long i = 0; i < numSamples; i++) {
+            sortedSamples[2 * i] = x(order[i]);
+            sortedSamples[2 * i + 1] = y(order[i]);
+        }
+
+        ownedSamples = std::move(sortedSamples);
+        samples = ownedSamples.data();
+        stride = 2;
+        xOffset = 0;
+        yOffset = 1;
+        if (mapping) {
+            file.unmap(mapping);
+            mapping = nullptr;
+        }
+        return true;
+    }
+
+    void DataTable::buildPyramid() {
+        // First level from pairs of samples
+        std::vector<Bucket> level((numSamples + 1) / 2);
+        for (unsigned long b = 0; b < level.size(); b++) {
+            unsigned long i = 2 * b, j = std::min(i + 1, numSamples - 1);
+            level[b] = {x(i), x(j), std::min(y(i), y(j)), std::max(y(i), y(j)), y(i), y(j)};
+        }
+
+        // Every next level merges pairs of buckets of the previous one
+        while (level.size() > 1) {
+            std::vector<Bucket> next((level.size() + 1) / 2);
+            for (unsigned long b = 0; b < next.size(); b++) {
+                const Bucket& l = level[2 * b];
+                const Bucket& r = level[std::min(2 * b + 1, level.size() - 1)];
+                next[b] = {l.xMin, r.xMax, std::min(l.yMin, r.yMin), std::max(l.yMax, r.yMax), l.yFirst, r.yLast};
+            }
+            levels.push_back(std::move(level));
+            level = std::move(next);
+        }
+        levels.push_back(std::move(level));
+    }
+
+
+    void DataTable::selectSamples(const BoundingBox& boundingBox, unsigned long& first, unsigned long& last) const {
+        auto indices = std::views::iota(0ul, numSamples);
+        auto lo = std::ranges::partition_point(indices, [this, &boundingBox](unsigned long i) { return x(i) < boundingBox.minX; });
+        auto hi = std::ranges::partition_point(lo, indices.end(), [this, &boundingBox](unsigned long i) { return x(i) <= boundingBox.maxX; });
+        auto loIndex = (unsigned long) (lo - indices.begin()), hiIndex = (unsigned long) (hi - indices.begin());
+        first = loIndex > 0 ? loIndex - 1 : 0;
+        last = std::min(hiIndex + 1, numSamples);
+    }
+
+    void DataTable::selectRange(const BoundingBox& boundingBox, double precision, int& level, unsigned long& first, unsigned long& last) const {
+        // Samples in view, plus one either side so lines continue past the edges
+        selectSamples(boundingBox, first, last);
+
+        // Use buckets of at least as many samples as fall into a sample width on average
+        double columnsInView = std::max(1.0, (double) boundingBox.width() / precision);
+        double samplesPerColumn = (double) (last - first) / columnsInView;
+        level = samplesPerColumn > 2 ? (int) std::ceil(std::log2(samplesPerColumn)) : 0;
+        level = std::min(level, (int) levels.size());
+
+        if (level > 0) {
+            first >>= level;
+            last = ((last - 1) >> level) + 1;
+        }
+    }
+
+    unsigned long DataTable::getNumVertices(BoundingBox boundingBox, double precision) const {
+        int level;
+        unsigned long first, last;
+        selectRange(boundingBox, precision, level, first, last);
+        if (last <= first) return 0;
+
+        unsigned long count = last - first;
+        if (style == Style::DENSITY) return 0;
+        if (style == Style::POINTS) return 2 * count;
+        if (level == 0) return 2 * (count - 1);
+        return 4 * count - 2;
+    }
+
+    unsigned long DataTable::writeVertices(float* vertices, BoundingBox boundingBox, double precision) const {
+        int level;
+        unsigned long first, last;
+        selectRange(boundingBox, precision, level, first, last);
+        if (last <= first || style == Style::DENSITY) return 0;
+
+        int vertIndex = 0;
+
+        if (level == 0) {
+            for (unsigned long i = first; i < last; i++) {
+                // Points are zero-length segments, which are drawn as dots
+                if (style == Style::POINTS) {
+                    writeVertex(vertices, vertIndex++, x(i), y(i));
+                    writeVertex(vertices, vertIndex++, x(i), y(i));
+                } else if (i > first) {
+                    writeVertex(vertices, vertIndex++, x(i - 1), y(i - 1));
+                    writeVertex(vertices, vertIndex++, x(i), y(i));
+                }
+            }
+            return vertIndex;
+        }
+
+        // Each bucket is drawn as its vertical extent, joined to the previous bucket when drawing a line
+        const std::vector<Bucket>& buckets = levels.at(level - 1);
+        for (unsigned long b = first; b < last; b++) {
+            const Bucket& bucket = buckets[b];
+            float center = 0.5f * (bucket.xMin + bucket.xMax);
+
+            if (style == Style::LINE && b > first) {
+                const Bucket& prev = buckets[b - 1];
+                writeVertex(vertices, vertIndex++, 0.5f * (prev.xMin + prev.xMax), prev.yLast);
+                writeVertex(vertices, vertIndex++, center, bucket.yFirst);
+            }
+            writeVertex(vertices, vertIndex++, center, bucket.yMin);
+            writeVertex(vertices, vertIndex++, center, bucket.yMax);
+        }
+        return vertIndex;
+    }
+
+
+    std::string DataTable::getTypeName() const {
+        return "table";
+    }
+
+    // Segments are already reduced by the pyramid, and points must keep their zero-length segments, so neither is
+    // decimated. Densities bin only the samples within the horizontal range, so the cost follows the visible samples
+    void DataTable::writeGeometry(Snapshot& snapshot, BoundingBox region, double precision, double pixelSize) const {
+        if (style != Style::DENSITY) {
+            writeSegments(snapshot.vertices, region, precision);
+            return;
+        }
+
+        // One texel per pixel, whatever the sample width
+        const double texelSize = pixelSize > 0 ? pixelSize : precision;
+        snapshot.vertices.clear();
+        snapshot.densityWidth = std::min(MAX_DENSITY_SIZE, (int) std::ceil(region.width() / texelSize));
+        snapshot.densityHeight = std::min(MAX_DENSITY_SIZE, (int) std::ceil(region.height() / texelSize));
+
+        unsigned long first, last;
+        selectSamples(region, first, last);
+        const float* row = samples + first * stride;
+        std::scoped_lock<std::mutex> lock(splatMutex);
+        splatPoints(row + xOffset, row + yOffset, last - first, stride, region, snapshot.densityWidth,
+                    snapshot.densityHeight, snapshot.density, splatBuffers);
+    }
+
+    DataTable::Columns DataTable::getColumns() const {
+        return columns;
+    }
+
+    DataTable::Style DataTable::getStyle() const {
+        return style;
+    }
+
+    unsigned long DataTable::getNumSamples() const {
+        return numSamples;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <QFile>
+#include <QString>
+
+#include "equation.h"
+#include "core/density.h"
+
+
+namespace Cubiq {
+
+    // Samples read from a CSV or raw binary file, drawn as a line or as points. The file is memory-mapped and a
+    // min/max pyramid is built once when it is loaded, so drawing any region only touches about one bucket per sample
+    // width, however many samples the file has
+    class DataTable : public Equation {
+
+    public:
+        enum class Style {
+            LINE, POINTS, DENSITY
+        };
+
+        struct Columns {
+            int x = 0, y = 1;
+            int count = 2; // Values per row of a binary file
+        };
+
+        static const int MAX_DENSITY_SIZE;
+
+        // Opens a data file. Files ending in .csv are parsed as text; anything else is read as rows of native float
+        // values. Returns nullptr and sets the error if the file cannot be used
+        static DataTable* load(const QString& path, Columns columns, Style style, DisplaySettings settings, std::string& error);
+        ~DataTable() override;
+
+        unsigned long getNumVertices(BoundingBox boundingBox, double precision) const override;
+        unsigned long writeVertices(float* vertices, BoundingBox boundingBox, double precision) const override;
+
+        std::string getTypeName() const override;
+        void writeGeometry(Snapshot& snapshot, BoundingBox region, double precision, double pixelSize) const override;
+
+        Columns getColumns() const;
+        Style getStyle() const;
+        unsigned long getNumSamples() const;
+
+    private:
+        // Extent of a run of consecutive samples
+        struct Bucket {
+            float xMin, xMax, yMin, yMax;
+            float yFirst, yLast;
+        };
+
+        QFile file;
+        uchar* mapping;
+
+        // Rows of stride floats sorted by x, either in the mapping or in ownedSamples
+        const float* samples;
+        unsigned long numSamples;
+        int stride, xOffset, yOffset;
+        std::vector<float> ownedSamples;
+
+        // Level k has buckets of 2^(k+1) samples
+        std::vector<std::vector<Bucket>> levels;
+
+        Columns columns;
+        Style style;
+
+        // Kept for redrawing the density, and freed with the table. Views drawing it at once take turns
+        mutable SplatBuffers splatBuffers;
+        mutable std::mutex splatMutex;
+
+        DataTable(const QString& path, Columns columns, Style style, DisplaySettings settings);
+
+        bool loadCSV(std::string& error);
+        bool loadBinary(std::string& error);
+        bool sortSamples(std::string& error);
+        void buildPyramid();
+
+        float x(unsigned long i) const { return samples[i * stride + xOffset]; }
+        float y(unsigned long i) const { return samples[i * stride + yOffset]; }
+
+        // Range [first, last) of samples covering the bounding box horizontally, plus one on either side
+        void selectSamples(const BoundingBox& boundingBox, unsigned long& first, unsigned long& last) const;
+
+        // Chooses the finest level with no more than about one bucket per sample width, where level 0 is the samples
+        // themselves, and the range [first, last) of items of that level needed to draw the bounding box
+        void selectRange(const BoundingBox& boundingBox, double precision, int& level, unsigned long& first, unsigned long& last) const;
+
+    };
+
+}
\ No newline at end of file
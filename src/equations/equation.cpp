@@ -1,25 +1,85 @@
 #include "equation.h"
 
+#include <utility>
+
+#include "core/decimation.h"
+#include "core/trace.h"
+
 
 namespace Cubiq {
 
-    const int Equation::NUM_THREADS = 4;
+    const int Equation::DEFAULT_NUM_THREADS = 4;
+    const int Equation::FLOATS_PER_VERTEX = 2; // Vertices are (x, y) only; color is uniform per equation
+    const float Equation::FILL_ALPHA = 0.3f; // Opacity of shaded regions relative to their outline
+
+    int Equation::numThreads = DEFAULT_NUM_THREADS;
+
+    int Equation::getNumThreads() {
+        return numThreads;
+    }
+
+    void Equation::setNumThreads(int n) {
+        numThreads = n;
+    }
 
-    GLfloat* Equation::getVertices(unsigned long& numVerts, BoundingBox boundingBox, double precision) const {
+    float* Equation::getVertices(unsigned long& numVerts, BoundingBox boundingBox, double precision) const {
         numVerts = getNumVertices(boundingBox, precision);
-        auto* vertices = new GLfloat[numVerts];
-        writeVertices(vertices, boundingBox, precision);
+        auto* vertices = new float[numVerts * FLOATS_PER_VERTEX];
+        numVerts = writeVertices(vertices, boundingBox, precision);
         return vertices;
     }
 
-    void Equation::writeVertex(GLfloat* vertices, int vertIndex, float x, float y) const {
-        vertices[7 * vertIndex] = x;
-        vertices[7 * vertIndex + 1] = y;
-        vertices[7 * vertIndex + 2] = 0;
-        vertices[7 * vertIndex + 3] = displaySettings.r;
-        vertices[7 * vertIndex + 4] = displaySettings.g;
-        vertices[7 * vertIndex + 5] = displaySettings.b;
-        vertices[7 * vertIndex + 6] = displaySettings.a;
+    void Equation::writeSegments(std::vector<float>& segments, BoundingBox boundingBox, double precision) const {
+        segments.resize(FLOATS_PER_VERTEX * getNumVertices(boundingBox, precision));
+        segments.resize(FLOATS_PER_VERTEX * writeVertices(segments.data(), boundingBox, precision));
+    }
+
+    const Equation::DisplaySettings& Equation::getDisplaySettings() const {
+        return displaySettings;
+    }
+
+    std::string Equation::getTypeName() const {
+        return "xy";
+    }
+
+    bool Equation::isPending() const {
+        return false;
+    }
+
+    // Plain segments, reduced to what can be seen at the pixel size
+    void Equation::writeGeometry(Snapshot& snapshot, BoundingBox region, double precision, double pixelSize) const {
+        {
+            TraceSpan span("Equation::writeVertices");
+            writeSegments(snapshot.vertices, region, precision);
+        }
+        TraceSpan span("decimateSegments");
+        decimateSegments(snapshot.vertices, pixelSize);
+    }
+
+    const std::string& Equation::getSource() const {
+        return source;
+    }
+
+    void Equation::setSource(std::string src) {
+        source = std::move(src);
+    }
+
+    const std::string& Equation::getShaderExpression() const {
+        return shaderExpression;
+    }
+
+    bool Equation::isShaderRegion() const {
+        return shaderRegion;
+    }
+
+    void Equation::setShaderExpression(std::string expression, bool region) {
+        shaderExpression = std::move(expression);
+        shaderRegion = region;
+    }
+
+    void Equation::writeVertex(float* vertices, int vertIndex, float x, float y) {
+        vertices[FLOATS_PER_VERTEX * vertIndex] = x;
+        vertices[FLOATS_PER_VERTEX * vertIndex + 1] = y;
     }
 
 }
\ No newline at end of file
@@ -1,8 +1,10 @@
 #pragma once
 
-#include <QOpenGLBuffer>
+#include <string>
+#include <vector>
 
 #include "core/bounding_box.h"
+#include "core/snapshot.h"
 
 
 namespace Cubiq {
@@ -12,21 +14,63 @@ namespace Cubiq {
     public:
         struct DisplaySettings {
             float r, g, b, a;
+            float lineWidth = 2.5f;
         };
 
-        static const int NUM_THREADS;
+        using ColorRun = Cubiq::ColorRun;
+
+        static const int DEFAULT_NUM_THREADS;
+        static const int FLOATS_PER_VERTEX;
+        static const float FILL_ALPHA;
+
+        // Threads used to calculate a single equation. Only to be changed while nothing is being calculated, e.g. by
+        // benchmarks measuring scaling
+        static int getNumThreads();
+        static void setNumThreads(int n);
 
         explicit Equation(DisplaySettings settings) { displaySettings = settings; }
         virtual ~Equation() {};
 
-        GLfloat* getVertices(unsigned long& numVerts, BoundingBox boundingBox, double precision) const;
+        float* getVertices(unsigned long& numVerts, BoundingBox boundingBox, double precision) const;
+        // Upper bound for the number of vertices written by writeVertices()
         virtual unsigned long getNumVertices(BoundingBox boundingBox, double precision) const = 0;
-        virtual void writeVertices(GLfloat* vertices, BoundingBox boundingBox, double precision) const = 0;
+        // Writes pairs of vertices forming line segments and returns the number of vertices written
+        virtual unsigned long writeVertices(float* vertices, BoundingBox boundingBox, double precision) const = 0;
+        // Same, for equations that cannot bound their number of vertices beforehand
+        virtual void writeSegments(std::vector<float>& segments, BoundingBox boundingBox, double precision) const;
+
+        const DisplaySettings& getDisplaySettings() const;
+
+        // Element type and LaTeX source the equation was created from, as stored in graph files
+        virtual std::string getTypeName() const;
+        // Whether the equation cannot be calculated yet, so any geometry it already has should be kept
+        virtual bool isPending() const;
+
+        // Fills the geometry of a snapshot covering the region: segments, along with triangles shading a region or
+        // runs of color for equations drawn that way, or a density image. How the snapshot is drawn follows from what
+        // it holds. The pixel size of the view, or 0 if there is none, bounds how finely the geometry is worth keeping
+        virtual void writeGeometry(Snapshot& snapshot, BoundingBox region, double precision, double pixelSize) const;
+
+        const std::string& getSource() const;
+        void setSource(std::string src);
+
+        // GLSL expression of x and y for equations drawn where it is zero, so a view can draw them per pixel on the GPU
+        // instead of calculating their geometry. Empty if the equation has none. Regions are also shaded where it is
+        // negative
+        const std::string& getShaderExpression() const;
+        bool isShaderRegion() const;
+        void setShaderExpression(std::string expression, bool region = false);
 
     protected:
         DisplaySettings displaySettings{};
+        std::string source;
+        std::string shaderExpression;
+        bool shaderRegion = false;
+
+        static void writeVertex(float* vertices, int vertIndex, float x, float y);
 
-        void writeVertex(GLfloat* vertices, int vertIndex, float x, float y) const;
+    private:
+        static int numThreads;
 
     };
 
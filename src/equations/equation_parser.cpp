@@ -0,0 +1,180 @@
+#include "equation_parser.h"
+
+#include <memory>
+
+#include "function.h"
+#include "implicit_equation.h"
+#include "inequality.h"
+#include "parametric.h"
+#include "polar.h"
+#include "core/trace.h"
+#include "parser/evaluator.h"
+#include "parser/glsl_translator.h"
+#include "parser/interpreter.h"
+
+
+namespace Cubiq {
+
+    namespace {
+
+        using namespace Parser;
+
+        bool isSymbol(const Expression& expr, const std::string& name) {
+            return expr.isSymbol() && expr.getSymbol().name == name;
+        }
+
+        Equation* makeFunction(Equation::DisplaySettings settings, Function::IndependentVariable inVar,
+                               const Expression& expr, const std::string& var) {
+            auto compiled = std::make_shared<const CompiledExpression>(expr, std::vector<std::string>{var});
+            return new Function(settings, inVar, [compiled](float in) {
+                return (float) compiled->evaluate(in);
+            });
+        }
+
+        Equation* makeImplicit(Equation::DisplaySettings settings, GraphContext& context, const Expression& lhs,
+                               const Expression& rhs) {
+            Expression difference(context, Operation::SUB, {lhs, rhs});
+            auto compiled = std::make_shared<const CompiledExpression>(difference, std::vector<std::string>{"x", "y"});
+            auto* equation = new ImplicitEquation(settings, [compiled](float x, float y) {
+                return (float) compiled->evaluate(x, y);
+            });
+
+            // Equations with anything the shader cannot express are only ever calculated on the CPU
+            try {
+                equation->setShaderExpression(translateToGLSL(difference, {"x", "y"}));
+            } catch (const Error&) {}
+            return equation;
+        }
+
+        // The region is wherever the smaller side minus the larger one is negative. Whether the boundary itself is
+        // included makes no difference to the shading
+        Equation* makeInequality(Equation::DisplaySettings settings, GraphContext& context, Operation operation,
+                                 const Expression& lhs, const Expression& rhs) {
+            const bool less = operation == Operation::LT || operation == Operation::LTEQ;
+            Expression difference(context, Operation::SUB, {less ? lhs : rhs, less ? rhs : lhs});
+            auto compiled = std::make_shared<const CompiledExpression>(difference, std::vector<std::string>{"x", "y"});
+            auto* equation = new Inequality(settings, [compiled](float x, float y) {
+                return (float) compiled->evaluate(x, y);
+            });
+
+            try {
+                equation->setShaderExpression(translateToGLSL(difference, {"x", "y"}), true);
+            } catch (const Error&) {}
+            return equation;
+        }
+
+        Equation* makeParametric(Equation::DisplaySettings settings, const Expression& xExpr, const Expression& yExpr) {
+            auto xCompiled = std::make_shared<const CompiledExpression>(xExpr, std::vector<std::string>{"t"});
+            auto yCompiled = std::make_shared<const CompiledExpression>(yExpr, std::vector<std::string>{"t"});
+            return new Parametric(settings, [xCompiled, yCompiled](float t, float& x, float& y) {
+                x = (float) xCompiled->evaluate(t);
+                y = (float) yCompiled->evaluate(t);
+            }, 0, 1);
+        }
+
+        Equation* makePolar(Equation::DisplaySettings settings, const Expression& expr) {
+            auto compiled = std::make_shared<const CompiledExpression>(expr, std::vector<std::string>{"\\theta"});
+            return new Polar(settings, [compiled](float theta) {
+                return (float) compiled->evaluate(theta);
+            });
+        }
+
+        bool isInequality(const Expression& expr) {
+            if (!expr.isOperation()) return false;
+            const Operation operation = expr.getOperation();
+            return operation == Operation::LT || operation == Operation::GT || operation == Operation::LTEQ ||
+                   operation == Operation::GTEQ;
+        }
+
+        // The whole source must be a single expression
+        Expression parseSource(GraphContext& context, const std::string& source) {
+            std::string::size_type pos = 0;
+            CharStream stream = [&]() -> int {
+                return pos < source.size() ? (unsigned char) source[pos++] : -1;
+            };
+
+            TokenIterator it(stream);
+            Expression expr = generateParseTree(context, it, DataType::NOTHING, false);
+            if (it) throw Error{ErrorType::UNEXPECTED, it->toString()};
+            return expr;
+        }
+
+        Equation* parseXY(const std::string& source, Equation::DisplaySettings settings) {
+            GraphContext context;
+            Expression expr = parseSource(context, source);
+
+            if (isInequality(expr)) {
+                return makeInequality(settings, context, expr.getOperation(), expr.getChildren()[0], expr.getChildren()[1]);
+            }
+
+            // A bare point is traced as its parameter goes from 0 to 1
+            if (expr.isOperation() && expr.getOperation() == Operation::POINT) {
+                return makeParametric(settings, expr.getChildren().at(0), expr.getChildren().at(1));
+            }
+
+            // A bare expression is a function of x
+            if (!expr.isOperation() || expr.getOperation() != Operation::EQ) {
+                return makeFunction(settings, Function::IndependentVariable::X, expr, "x");
+            }
+
+            const Expression& lhs = expr.getChildren()[0];
+            const Expression& rhs = expr.getChildren()[1];
+
+            if (isSymbol(lhs, "r") && !references(rhs, "r")) return makePolar(settings, rhs);
+            if (isSymbol(rhs, "r") && !references(lhs, "r")) return makePolar(settings, lhs);
+            if (isSymbol(lhs, "y") && !references(rhs, "y")) {
+                return makeFunction(settings, Function::IndependentVariable::X, rhs, "x");
+            }
+            if (isSymbol(rhs, "y") && !references(lhs, "y")) {
+                return makeFunction(settings, Function::IndependentVariable::X, lhs, "x");
+            }
+            if (isSymbol(lhs, "x") && !references(rhs, "x")) {
+                return makeFunction(settings, Function::IndependentVariable::Y, rhs, "y");
+            }
+            if (isSymbol(rhs, "x") && !references(lhs, "x")) {
+                return makeFunction(settings, Function::IndependentVariable::Y, lhs, "y");
+            }
+            return makeImplicit(settings, context, lhs, rhs);
+        }
+
+    }
+
+
+    Equation* parseEquation(const std::string& type, const std::string& source, Equation::DisplaySettings settings) {
+        TraceSpan span("parseEquation");
+
+        Equation* equation;
+        if (type == "xy") equation = parseXY(source, settings);
+        else if (type == "contour") equation = parseContourMap(source, settings, {}, false);
+        else throw Parser::Error{Parser::ErrorType::BAD_TYPE, type};
+
+        equation->setSource(source);
+        return equation;
+    }
+
+    ContourMap* parseContourMap(const std::string& source, Equation::DisplaySettings settings, ContourMap::Levels levels,
+                                bool heatmap) {
+        TraceSpan span("parseContourMap");
+
+        Parser::GraphContext context;
+        Parser::Expression expr = parseSource(context, source);
+        auto compiled = std::make_shared<const Parser::CompiledExpression>(expr, std::vector<std::string>{"x", "y"});
+        auto* map = new ContourMap(settings, [compiled](float x, float y) {
+            return (float) compiled->evaluate(x, y);
+        }, levels, heatmap);
+        map->setSource(source);
+        return map;
+    }
+
+    std::string describeError(const Parser::Error& error) {
+        switch (error.type) {
+            case Parser::ErrorType::UNEXPECTED: return "Unexpected '" + error.content + "'";
+            case Parser::ErrorType::UNEXPECTED_OPERAND: return "Expected an operator before '" + error.content + "'";
+            case Parser::ErrorType::EXPECTED_OPERAND: return "Expected an operand";
+            case Parser::ErrorType::MISSING: return "Missing '" + error.content + "'";
+            case Parser::ErrorType::BAD_TYPE: return "Cannot evaluate '" + error.content + "'";
+            default: return "Unknown error";
+        }
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+#include "equation.h"
+#include "contour_map.h"
+#include "parser/defs.h"
+
+
+namespace Cubiq {
+
+    // Compiles the LaTeX source of a graph element into an equation. Throws Parser::Error if the source is invalid or
+    // the type is not supported
+    Equation* parseEquation(const std::string& type, const std::string& source, Equation::DisplaySettings settings);
+
+    // Compiles the LaTeX source of a contour map, an expression of x and y. Throws Parser::Error if it is invalid
+    ContourMap* parseContourMap(const std::string& source, Equation::DisplaySettings settings, ContourMap::Levels levels,
+                                bool heatmap);
+
+    // Human-readable description of a parser error
+    std::string describeError(const Parser::Error& error);
+
+}
\ No newline at end of file
@@ -1,19 +1,22 @@
 #include "function.h"
 
 #include <cmath>
+#include <utility>
+
+#include "core/counters.h"
 
 
 namespace Cubiq {
 
-    Function::Function(DisplaySettings settings, Function::IndependentVariable inVar, float (* func)(float)) : Equation(
-            settings) {
+    Function::Function(DisplaySettings settings, Function::IndependentVariable inVar, std::function<float(float)> func) :
+            Equation(settings) {
         inputVar = inVar;
-        function = func;
+        function = std::move(func);
     }
 
 
     float Function::apply(float input) const {
-        return (*function)(input);
+        return function(input);
     }
 
 
@@ -34,11 +37,11 @@ namespace Cubiq {
         return 2 * (unsigned long) ((inMax - inMin) / precision);
     }
 
-    void Function::writeVertices(GLfloat* vertices, BoundingBox boundingBox, double precision) const {
+    unsigned long Function::writeVertices(float* vertices, BoundingBox boundingBox, double precision) const {
 
         unsigned long numVerts = getNumVertices(boundingBox, precision);
 
-        if (numVerts == 0) { return; }
+        if (numVerts == 0) { return 0; }
 
         double inMin = 0, outMin = 0, outMax = 0;
         switch (inputVar) {
@@ -87,7 +90,8 @@ namespace Cubiq {
 
         }
 
-        while (vertIndex < numVerts) { writeVertex(vertices, vertIndex++, 0, 0); }
+        Counters::evaluations.fetch_add(numSegments + 1, std::memory_order_relaxed);
+        return vertIndex;
 
     }
 
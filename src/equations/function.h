@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+
 #include "equation.h"
 
 
@@ -12,16 +14,16 @@ namespace Cubiq {
             X, Y
         };
 
-        Function(DisplaySettings settings, IndependentVariable inVar, float (* func)(float));
+        Function(DisplaySettings settings, IndependentVariable inVar, std::function<float(float)> func);
 
         unsigned long getNumVertices(BoundingBox boundingBox, double precision) const override;
-        void writeVertices(GLfloat* vertices, BoundingBox boundingBox, double precision) const override;
+        unsigned long writeVertices(float* vertices, BoundingBox boundingBox, double precision) const override;
 
         float apply(float input) const;
 
     private:
         IndependentVariable inputVar;
-        float (* function)(float);
+        std::function<float(float)> function;
 
     };
 
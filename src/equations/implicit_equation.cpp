@@ -1,49 +1,40 @@
 #include "implicit_equation.h"
 
-#include <cmath>
+#include <utility>
 
 
 namespace Cubiq {
 
-    ImplicitEquation::ImplicitEquation(DisplaySettings settings, float (* func)(float, float)) : Equation(settings) {
-        function = func;
+    ImplicitEquation::ImplicitEquation(DisplaySettings settings, std::function<float(float, float)> func) :
+            Equation(settings) {
+        function = std::move(func);
     }
 
     float ImplicitEquation::apply(float x, float y) const {
-        return (*function)(x, y);
+        return function(x, y);
     }
 
     unsigned long ImplicitEquation::getNumVertices(BoundingBox boundingBox, double precision) const {
-        int gridWidth = (int) (std::ceil(boundingBox.maxX / precision) - std::floor(boundingBox.minX / precision));
-        int gridHeight = (int) (std::ceil(boundingBox.maxY / precision) - std::floor(boundingBox.minY / precision));
-        if (gridWidth <= 0 or gridHeight <= 0) { return 0; }
-        return 4 * gridWidth * gridHeight; // At most 4 vertices per cell
+        ValueGrid grid(boundingBox, precision);
+        if (grid.isEmpty()) { return 0; }
+        return 4 * (unsigned long) grid.getWidth() * grid.getHeight(); // At most 4 vertices per cell
     }
 
-    void ImplicitEquation::writeVertices(GLfloat* vertices, BoundingBox boundingBox, double precision) const {
+    unsigned long ImplicitEquation::writeVertices(float* vertices, BoundingBox boundingBox, double precision) const {
+        ValueGrid grid(boundingBox, precision);
+        if (grid.isEmpty()) { return 0; }
 
-        unsigned long numVerts = getNumVertices(boundingBox, precision);
-        if (numVerts == 0) { return; }
-
-        int gridWidth = (int) (std::ceil(boundingBox.maxX / precision) - std::floor(boundingBox.minX / precision));
-        int gridHeight = (int) (std::ceil(boundingBox.maxY / precision) - std::floor(boundingBox.minY / precision));
-
-
-        // Calculate values
-        float** values = new float* [gridHeight + 1];
-
-        float x, y;
+        grid.evaluate(function);
+        return writeContour(grid, vertices);
+    }
 
-        #pragma omp parallel for num_threads(Equation::NUM_THREADS) shared(gridHeight, gridWidth, values, precision, boundingBox) private(x, y) default(none)
-        for (int yInd = 0; yInd < gridHeight + 1; yInd++) {
-            values[yInd] = new float[gridWidth + 1];
+    // Writes the segments of the zero contour through each cell of an evaluated grid, at 4 vertices per cell
+    unsigned long ImplicitEquation::writeContour(const ValueGrid& grid, float* vertices) const {
 
-            y = (float) ((std::floor(boundingBox.minY / precision) + (double) yInd) * precision);
-            for (int xInd = 0; xInd < gridWidth + 1; xInd++) {
-                x = (float) ((std::floor(boundingBox.minX / precision) + (double) xInd) * precision);
-                values[yInd][xInd] = apply(x, y);
-            }
-        }
+        const int gridWidth = grid.getWidth();
+        const int gridHeight = grid.getHeight();
+        const unsigned long numVerts = 4 * (unsigned long) gridWidth * gridHeight;
+        const double precision = grid.getCellSize();
 
         // Create vertices
         int vertIndex;
@@ -52,7 +43,7 @@ namespace Cubiq {
         float v1x, v1y, v2x, v2y, v3x, v3y, v4x, v4y;
         bool v1, v2, v3, v4;
 
-        #pragma omp parallel for num_threads(Equation::NUM_THREADS) collapse(2) shared(vertices, gridHeight, gridWidth, values, precision, boundingBox) private(vertIndex, tl, tr, bl, br, l, r, b, t, c, v1x, v1y, v2x, v2y, v3x, v3y, v4x, v4y, v1, v2, v3, v4) default(none)
+        #pragma omp parallel for num_threads(Equation::getNumThreads()) collapse(2) shared(vertices, gridHeight, gridWidth, grid, precision) private(vertIndex, tl, tr, bl, br, l, r, b, t, c, v1x, v1y, v2x, v2y, v3x, v3y, v4x, v4y, v1, v2, v3, v4) default(none)
         for (int x = 0; x < gridWidth; x++) {
             for (int y = 0; y < gridHeight; y++) {
 
@@ -63,10 +54,10 @@ namespace Cubiq {
                 writeVertex(vertices, vertIndex + 2, 0, 0);
                 writeVertex(vertices, vertIndex + 3, 0, 0);
 
-                tl = values[y + 1][x];
-                tr = values[y + 1][x + 1];
-                bl = values[y][x];
-                br = values[y][x + 1];
+                tl = grid.at(x, y + 1);
+                tr = grid.at(x + 1, y + 1);
+                bl = grid.at(x, y);
+                br = grid.at(x + 1, y);
 
                 if ((tl > 0 and tr > 0 and bl > 0 and br > 0) or (tl < 0 and tr < 0 and bl < 0 and br < 0) or
                     (tl == 0 and tr == 0 and bl == 0 and br == 0)) {
@@ -75,9 +66,9 @@ namespace Cubiq {
 
                 v1 = v2 = v3 = v4 = false;
 
-                l = (float) ((std::floor(boundingBox.minX / precision) + x) * precision);
+                l = grid.x(x);
                 r = l + (float) precision;
-                b = (float) ((std::floor(boundingBox.minY / precision) + y) * precision);
+                b = grid.y(y);
                 t = b + (float) precision;
 
 
@@ -152,10 +143,8 @@ namespace Cubiq {
             }
         }
 
-        for (int y = 0; y < gridHeight + 1; y++) {
-            delete[] values[y];
-        }
-        delete[] values;
+        // Cells without a contour are left as degenerate segments at (0, 0)
+        return numVerts;
 
     }
 
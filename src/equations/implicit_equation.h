@@ -1,6 +1,9 @@
 #pragma once
 
+#include <functional>
+
 #include "equation.h"
+#include "value_grid.h"
 
 
 namespace Cubiq {
@@ -8,15 +11,17 @@ namespace Cubiq {
     class ImplicitEquation : public Equation {
 
     public:
-        ImplicitEquation(DisplaySettings settings, float (* func)(float, float));
+        ImplicitEquation(DisplaySettings settings, std::function<float(float, float)> func);
 
         float apply(float x, float y) const; // Function drawn where apply(x,y)=0
 
         unsigned long getNumVertices(BoundingBox boundingBox, double precision) const override;
-        void writeVertices(GLfloat* vertices, BoundingBox boundingBox, double precision) const override;
+        unsigned long writeVertices(float* vertices, BoundingBox boundingBox, double precision) const override;
+
+    protected:
+        std::function<float(float, float)> function;
 
-    private:
-        float (* function)(float, float);
+        unsigned long writeContour(const ValueGrid& grid, float* vertices) const;
 
     };
 
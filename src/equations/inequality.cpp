@@ -0,0 +1,145 @@
+#include "inequality.h"
+
+#include <utility>
+
+#include "core/decimation.h"
+
+
+namespace Cubiq {
+
+    namespace {
+
+        bool isInside(float value) {
+            return value < 0; // Never where the value is undefined
+        }
+
+        // Fraction of the way from a to b at which the value crosses zero. Edges to corners where the value is
+        // undefined are cut halfway
+        float crossing(float a, float b) {
+            float t = a / (a - b);
+            return t >= 0 && t <= 1 ? t : 0.5f;
+        }
+
+        void addVertex(std::vector<float>& out, float x, float y) {
+            out.push_back(x);
+            out.push_back(y);
+        }
+
+        void addQuad(std::vector<float>& out, float l, float r, float b, float t) {
+            addVertex(out, l, b);
+            addVertex(out, r, b);
+            addVertex(out, r, t);
+            addVertex(out, l, b);
+            addVertex(out, r, t);
+            addVertex(out, l, t);
+        }
+
+    }
+
+
+    Inequality::Inequality(DisplaySettings settings, std::function<float(float, float)> func) :
+            ImplicitEquation(settings, std::move(func)) {}
+
+    // The region and its outline come from one evaluation of the grid. Only the outline is decimated, as the
+    // triangles must keep meeting it
+    void Inequality::writeGeometry(Snapshot& snapshot, BoundingBox region, double precision, double pixelSize) const {
+        std::vector<float>& triangles = snapshot.fill;
+        std::vector<float>& segments = snapshot.vertices;
+        triangles.clear();
+        segments.clear();
+
+        ValueGrid grid(region, precision);
+        if (grid.isEmpty()) return;
+        grid.evaluate(function);
+
+        writeRegion(grid, triangles);
+        segments.resize(FLOATS_PER_VERTEX * getNumVertices(region, precision));
+        segments.resize(FLOATS_PER_VERTEX * writeContour(grid, segments.data()));
+        decimateSegments(segments, pixelSize);
+    }
+
+    // Every edge is cut where the boundary's segments cross it, and shared edges of neighbouring cells are always
+    // interpolated in the same direction, so the triangles meet without cracks
+    void Inequality::writeRegion(const ValueGrid& grid, std::vector<float>& triangles) const {
+        int gridWidth = grid.getWidth();
+        int gridHeight = grid.getHeight();
+        std::vector<std::vector<float>> rows(gridHeight);
+
+        #pragma omp parallel for num_threads(Equation::getNumThreads()) schedule(dynamic) shared(grid, rows, gridWidth, gridHeight) default(none)
+        for (int y = 0; y < gridHeight; y++) {
+            std::vector<float>& out = rows[y];
+            const float b = grid.y(y), t = grid.y(y + 1);
+            int runStart = -1; // First cell of the current run of cells entirely inside
+
+            for (int x = 0; x <= gridWidth; x++) {
+                float bl = 0, br = 0, tl = 0, tr = 0;
+                bool full = false;
+                if (x < gridWidth) {
+                    bl = grid.at(x, y);
+                    br = grid.at(x + 1, y);
+                    tl = grid.at(x, y + 1);
+                    tr = grid.at(x + 1, y + 1);
+                    full = isInside(bl) && isInside(br) && isInside(tl) && isInside(tr);
+                }
+
+                if (full) {
+                    if (runStart < 0) runStart = x;
+                    continue;
+                }
+                if (runStart >= 0) {
+                    addQuad(out, grid.x(runStart), grid.x(x), b, t);
+                    runStart = -1;
+                }
+                if (x == gridWidth || !(isInside(bl) || isInside(br) || isInside(tl) || isInside(tr))) continue;
+
+                const float l = grid.x(x), r = grid.x(x + 1);
+                const float bottom = l + crossing(bl, br) * (r - l);
+                const float right = b + crossing(br, tr) * (t - b);
+                const float top = l + crossing(tl, tr) * (r - l);
+                const float left = b + crossing(bl, tl) * (t - b);
+
+                // Two opposite corners inside are only connected if the center is as well
+                const bool saddle = isInside(bl) == isInside(tr) && isInside(br) == isInside(tl);
+                if (saddle && !isInside(apply((l + r) / 2, (b + t) / 2))) {
+                    if (isInside(bl)) {
+                        addVertex(out, l, b); addVertex(out, bottom, b); addVertex(out, l, left);
+                        addVertex(out, r, t); addVertex(out, top, t); addVertex(out, r, right);
+                    } else {
+                        addVertex(out, r, b); addVertex(out, r, right); addVertex(out, bottom, b);
+                        addVertex(out, l, t); addVertex(out, l, left); addVertex(out, top, t);
+                    }
+                    continue;
+                }
+
+                // The part of the cell inside is convex, so it is drawn as a fan around its first point
+                float polygon[16];
+                int numPoints = 0;
+                auto add = [&](float px, float py) {
+                    polygon[2 * numPoints] = px;
+                    polygon[2 * numPoints + 1] = py;
+                    numPoints++;
+                };
+                if (isInside(bl)) add(l, b);
+                if (isInside(bl) != isInside(br)) add(bottom, b);
+                if (isInside(br)) add(r, b);
+                if (isInside(br) != isInside(tr)) add(r, right);
+                if (isInside(tr)) add(r, t);
+                if (isInside(tr) != isInside(tl)) add(top, t);
+                if (isInside(tl)) add(l, t);
+                if (isInside(tl) != isInside(bl)) add(l, left);
+
+                for (int i = 1; i + 1 < numPoints; i++) {
+                    addVertex(out, polygon[0], polygon[1]);
+                    addVertex(out, polygon[2 * i], polygon[2 * i + 1]);
+                    addVertex(out, polygon[2 * i + 2], polygon[2 * i + 3]);
+                }
+            }
+        }
+
+        unsigned long size = 0;
+        for (const std::vector<float>& row : rows) size += row.size();
+        triangles.reserve(size);
+        for (const std::vector<float>& row : rows) triangles.insert(triangles.end(), row.begin(), row.end());
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "implicit_equation.h"
+
+
+namespace Cubiq {
+
+    // Region where apply(x,y)<0, shaded along with its boundary. Both come from a single evaluation of the grid: cells
+    // entirely inside are merged into one quad per run along each row, and cells the boundary crosses are clipped to
+    // the part of them inside, with the same interpolation as the boundary's segments
+    class Inequality : public ImplicitEquation {
+
+    public:
+        Inequality(DisplaySettings settings, std::function<float(float, float)> func);
+
+        void writeGeometry(Snapshot& snapshot, BoundingBox region, double precision, double pixelSize) const override;
+
+    private:
+        void writeRegion(const ValueGrid& grid, std::vector<float>& triangles) const;
+
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "parametric.h"
+
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+#include "core/counters.h"
+
+
+namespace Cubiq {
+
+    namespace {
+
+        // Which sides of the region a point is beyond, as bits, so a segment is hidden if its ends share one
+        int outside(float x, float y, const BoundingBox& bb) {
+            return (x < bb.minX ? 1 : 0) | (x > bb.maxX ? 2 : 0) | (y < bb.minY ? 4 : 0) | (y > bb.maxY ? 8 : 0);
+        }
+
+    }
+
+
+    const int Parametric::INITIAL_SAMPLES = 256; // Uniform samples before any refinement
+    const unsigned long Parametric::MAX_SAMPLES = 1ul << 18; // Samples per curve at most
+    const double Parametric::MAX_CHORD = 4; // Longest segment drawn, in multiples of the precision
+    const double Parametric::MAX_DEVIATION = 0.05; // Farthest a midpoint may stray from its chord, likewise
+    const double Parametric::STALL_RATIO = 0.9; // Fraction of its length a half keeps when an interval does not shrink
+    const int Parametric::MAX_STALLS = 8; // Halvings in a row without shrinking before an interval is taken as a jump
+
+    Parametric::Parametric(DisplaySettings settings, PointFunction func, float from, float to) :
+            Equation(settings), function(std::move(func)), from(from), to(to) {}
+
+
+    void Parametric::apply(float t, float& x, float& y) const {
+        function(t, x, y);
+    }
+
+    float Parametric::getFrom() const {
+        return from;
+    }
+
+    float Parametric::getTo() const {
+        return to;
+    }
+
+    void Parametric::setRange(float newFrom, float newTo) {
+        from = newFrom;
+        to = newTo;
+    }
+
+
+    void Parametric::evaluate(std::vector<Sample>& samples) const {
+        const auto count = (long) samples.size();
+
+        #pragma omp parallel for num_threads(Equation::getNumThreads()) shared(samples, count) default(none)
+        for (long i = 0; i < count; i++) {
+            Sample& sample = samples[i];
+            apply(sample.t, sample.x, sample.y);
+        }
+
+        Counters::evaluations.fetch_add((unsigned long) count, std::memory_order_relaxed);
+    }
+
+    unsigned long Parametric::getNumVertices(BoundingBox boundingBox, double precision) const {
+        return 2 * MAX_SAMPLES;
+    }
+
+    unsigned long Parametric::writeVertices(float* vertices, BoundingBox boundingBox, double precision) const {
+        std::vector<float> segments;
+        writeSegments(segments, boundingBox, precision);
+        std::copy(segments.begin(), segments.end(), vertices);
+        return segments.size() / FLOATS_PER_VERTEX;
+    }
+
+    void Parametric::writeSegments(std::vector<float>& segments, BoundingBox boundingBox, double precision) const {
+        segments.clear();
+        if (!(to > from) || !std::isfinite(to - from) || !(precision > 0)) return;
+
+        const double maxChord = MAX_CHORD * precision;
+        const double maxDeviation = MAX_DEVIATION * precision;
+
+        std::vector<Sample> samples(INITIAL_SAMPLES + 1);
+        for (int i = 0; i <= INITIAL_SAMPLES; i++) {
+            samples[i].t = from + (to - from) * (float) i / (float) INITIAL_SAMPLES;
+        }
+        evaluate(samples);
+
+        auto isHidden = [&](const Sample& a, const Sample& b) {
+            return (outside(a.x, a.y, boundingBox) & outside(b.x, b.y, boundingBox)) != 0;
+        };
+        // The arc between two samples strays from their chord by about as much as its midpoint does, and by no more
+        // than the chord is long, so it cannot reach the region if the box around its ends is farther than that
+        auto canReach = [&](const Sample& a, const Sample& b, double reach) {
+            return std::min(a.x, b.x) - reach <= boundingBox.maxX && std::max(a.x, b.x) + reach >= boundingBox.minX &&
+                   std::min(a.y, b.y) - reach <= boundingBox.maxY && std::max(a.y, b.y) + reach >= boundingBox.minY;
+        };
+        // Whether the interval between two samples is still worth halving, given how far the midpoint of the interval
+        // it was halved from strayed from its chord, and how long that chord was
+        auto classify = [&](const Sample& a, const Sample& b, double deviation, double parentChord,
+                            unsigned char parentStalls) {
+            Interval interval{};
+            const bool aFinite = std::isfinite(a.x) && std::isfinite(a.y);
+            const bool bFinite = std::isfinite(b.x) && std::isfinite(b.y);
+            if (aFinite != bFinite) {
+                // Closes in on where the curve ends, e.g. where the radius becomes undefined
+                const Sample& end = aFinite ? a : b;
+                interval.active = canReach(end, end, maxChord);
+                return interval;
+            }
+            if (!aFinite) return interval;
+
+            // A continuous curve gets shorter between closer samples, while a jump stays as long however finely it is
+            // split
+            const double chord = std::hypot(b.x - a.x, b.y - a.y);
+            const bool stalled = chord > maxChord && chord > STALL_RATIO * parentChord;
+            interval.stalls = stalled ? parentStalls + 1 : 0;
+            if (interval.stalls >= MAX_STALLS) {
+                interval.jump = true;
+                return interval;
+            }
+            interval.active = (chord > maxChord || deviation > maxDeviation) && canReach(a, b, chord + deviation);
+            return interval;
+        };
+
+        // Nothing is known yet of how the curve bends between the first samples, so it is assumed to stray as far as
+        // their chord is long
+        std::vector<Interval> intervals(samples.size() - 1);
+        for (unsigned long i = 0; i < intervals.size(); i++) {
+            const Sample& a = samples[i];
+            const Sample& b = samples[i + 1];
+            intervals[i] = classify(a, b, std::hypot(b.x - a.x, b.y - a.y), INFINITY, 0);
+        }
+
+        std::vector<Sample> midpoints;
+        std::vector<Sample> refined;
+        std::vector<Interval> refinedIntervals;
+        while (true) {
+            midpoints.clear();
+            for (unsigned long i = 0; i < intervals.size(); i++) {
+                if (!intervals[i].active) continue;
+                const Sample& a = samples[i];
+                const Sample& b = samples[i + 1];
+                const float t = 0.5f * (a.t + b.t);
+                if (!(t > a.t && t < b.t)) {
+                    // Cannot be split any finer in single precision, so it is drawn as it is
+                    intervals[i].active = false;
+                    continue;
+                }
+                midpoints.push_back({t, 0, 0});
+            }
+            if (midpoints.empty() || samples.size() + midpoints.size() > MAX_SAMPLES) break;
+            evaluate(midpoints);
+
+            refined.clear();
+            refinedIntervals.clear();
+            auto mid = midpoints.begin();
+            for (unsigned long i = 0; i < intervals.size(); i++) {
+                const Sample& a = samples[i];
+                refined.push_back(a);
+                if (!intervals[i].active) {
+                    refinedIntervals.push_back(intervals[i]);
+                    continue;
+                }
+
+                const Sample& b = samples[i + 1];
+                const Sample& m = *mid++;
+                const double chord = std::hypot(b.x - a.x, b.y - a.y);
+                double deviation = std::hypot(m.x - 0.5 * (a.x + b.x), m.y - 0.5 * (a.y + b.y));
+                if (!std::isfinite(deviation)) deviation = 0;
+
+                refined.push_back(m);
+                refinedIntervals.push_back(classify(a, m, deviation, chord, intervals[i].stalls));
+                refinedIntervals.push_back(classify(m, b, deviation, chord, intervals[i].stalls));
+            }
+            refined.push_back(samples.back());
+
+            std::swap(samples, refined);
+            std::swap(intervals, refinedIntervals);
+        }
+
+        for (unsigned long i = 0; i < intervals.size(); i++) {
+            const Sample& a = samples[i];
+            const Sample& b = samples[i + 1];
+            if (intervals[i].jump || !std::isfinite(a.x + a.y + b.x + b.y) || isHidden(a, b)) continue;
+            segments.insert(segments.end(), {a.x, a.y, b.x, b.y});
+        }
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <functional>
+
+#include "equation.h"
+
+
+namespace Cubiq {
+
+    // Curve through (x(t), y(t)) as t goes from one value to another. The parameter is sampled adaptively: a coarse
+    // uniform pass, then passes halving every interval whose chord is long on screen or whose midpoint strays from the
+    // chord, i.e. where the curve bends. Each pass evaluates all of its midpoints as one parallel batch. Intervals whose
+    // arc cannot reach the region are not refined, so only the visible part of a long curve costs samples, however far
+    // the view is zoomed in
+    class Parametric : public Equation {
+
+    public:
+        using PointFunction = std::function<void(float t, float& x, float& y)>;
+
+        static const int INITIAL_SAMPLES;
+        static const unsigned long MAX_SAMPLES;
+        static const double MAX_CHORD;
+        static const double MAX_DEVIATION;
+        static const double STALL_RATIO;
+        static const int MAX_STALLS;
+
+        Parametric(DisplaySettings settings, PointFunction func, float from, float to);
+
+        void apply(float t, float& x, float& y) const;
+
+        float getFrom() const;
+        float getTo() const;
+        void setRange(float from, float to);
+
+        unsigned long getNumVertices(BoundingBox boundingBox, double precision) const override;
+        unsigned long writeVertices(float* vertices, BoundingBox boundingBox, double precision) const override;
+        void writeSegments(std::vector<float>& segments, BoundingBox boundingBox, double precision) const override;
+
+    private:
+        struct Sample {
+            float t, x, y;
+        };
+
+        // State of the interval after a sample
+        struct Interval {
+            unsigned char stalls; // Halvings in a row that left it about as long
+            bool active; // Still to be halved
+            bool jump; // The curve is discontinuous within it, so it is not drawn
+        };
+
+        PointFunction function;
+        float from, to;
+
+        void evaluate(std::vector<Sample>& samples) const;
+
+    };
+
+}
\ No newline at end of file
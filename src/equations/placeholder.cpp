@@ -0,0 +1,38 @@
+#include "placeholder.h"
+
+#include <utility>
+
+
+namespace Cubiq {
+
+    Placeholder::Placeholder(DisplaySettings settings, std::string type, std::string src, std::string error,
+                             std::string element) :
+            Equation(settings), typeName(std::move(type)), error(std::move(error)), element(std::move(element)) {
+        setSource(std::move(src));
+    }
+
+    unsigned long Placeholder::getNumVertices(BoundingBox boundingBox, double precision) const {
+        return 0;
+    }
+
+    unsigned long Placeholder::writeVertices(float* vertices, BoundingBox boundingBox, double precision) const {
+        return 0;
+    }
+
+    std::string Placeholder::getTypeName() const {
+        return typeName;
+    }
+
+    bool Placeholder::isPending() const {
+        return error.empty();
+    }
+
+    const std::string& Placeholder::getError() const {
+        return error;
+    }
+
+    const std::string& Placeholder::getElement() const {
+        return element;
+    }
+
+}
\ No newline at end of file
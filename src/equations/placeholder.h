@@ -0,0 +1,33 @@
+#pragma once
+
+#include "equation.h"
+
+
+namespace Cubiq {
+
+    // Stands in for an element that is still being compiled or failed to compile. Draws nothing, but keeps the type
+    // and source, and the element's text as it was read, so the element is not lost when the graph is saved again
+    class Placeholder : public Equation {
+
+    public:
+        Placeholder(DisplaySettings settings, std::string type, std::string src, std::string error = "",
+                    std::string element = "");
+
+        unsigned long getNumVertices(BoundingBox boundingBox, double precision) const override;
+        unsigned long writeVertices(float* vertices, BoundingBox boundingBox, double precision) const override;
+
+        std::string getTypeName() const override;
+        bool isPending() const override;
+        // Empty while the element is still compiling
+        const std::string& getError() const;
+        // JSON text of the element in the graph file, or empty if it was not read from one
+        const std::string& getElement() const;
+
+    private:
+        std::string typeName;
+        std::string error;
+        std::string element;
+
+    };
+
+}
\ No newline at end of file
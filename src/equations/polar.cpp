@@ -0,0 +1,18 @@
+#include "polar.h"
+
+#include <cmath>
+#include <numbers>
+
+
+namespace Cubiq {
+
+    const float Polar::DEFAULT_TO = (float) (12 * std::numbers::pi); // Enough turns for most spirals and roses
+
+    Polar::Polar(DisplaySettings settings, std::function<float(float)> radius, float from, float to) :
+            Parametric(settings, [radius](float theta, float& x, float& y) {
+                const float r = radius(theta);
+                x = r * std::cos(theta);
+                y = r * std::sin(theta);
+            }, from, to) {}
+
+}
\ No newline at end of file
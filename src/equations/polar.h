@@ -0,0 +1,18 @@
+#pragma once
+
+#include "parametric.h"
+
+
+namespace Cubiq {
+
+    // Curve at distance r(θ) from the origin, sampled as the parametric curve (r cos θ, r sin θ)
+    class Polar : public Parametric {
+
+    public:
+        static const float DEFAULT_TO;
+
+        Polar(DisplaySettings settings, std::function<float(float)> radius, float from = 0, float to = DEFAULT_TO);
+
+    };
+
+}
\ No newline at end of file
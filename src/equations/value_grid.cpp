@@ -0,0 +1,62 @@
+#include "value_grid.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "equation.h"
+#include "core/counters.h"
+
+
+namespace Cubiq {
+
+    ValueGrid::ValueGrid(BoundingBox boundingBox, double precision) : precision(precision) {
+        firstX = std::floor(boundingBox.minX / precision);
+        firstY = std::floor(boundingBox.minY / precision);
+        width = std::max(0, (int) (std::ceil(boundingBox.maxX / precision) - firstX));
+        height = std::max(0, (int) (std::ceil(boundingBox.maxY / precision) - firstY));
+    }
+
+    void ValueGrid::evaluate(const std::function<float(float, float)>& function) {
+        if (isEmpty()) return;
+        values.resize((size_t) (width + 1) * (height + 1));
+
+        #pragma omp parallel for num_threads(Equation::getNumThreads()) shared(function) default(none)
+        for (int yInd = 0; yInd < height + 1; yInd++) {
+            const float yPos = y(yInd);
+            float* row = values.data() + (size_t) yInd * (width + 1);
+            for (int xInd = 0; xInd < width + 1; xInd++) {
+                row[xInd] = function(x(xInd), yPos);
+            }
+        }
+        Counters::evaluations.fetch_add((unsigned long) (width + 1) * (height + 1), std::memory_order_relaxed);
+    }
+
+    int ValueGrid::getWidth() const {
+        return width;
+    }
+
+    int ValueGrid::getHeight() const {
+        return height;
+    }
+
+    bool ValueGrid::isEmpty() const {
+        return width <= 0 || height <= 0;
+    }
+
+    float ValueGrid::at(int xInd, int yInd) const {
+        return values[(size_t) yInd * (width + 1) + xInd];
+    }
+
+    float ValueGrid::x(int xInd) const {
+        return (float) ((firstX + xInd) * precision);
+    }
+
+    float ValueGrid::y(int yInd) const {
+        return (float) ((firstY + yInd) * precision);
+    }
+
+    double ValueGrid::getCellSize() const {
+        return precision;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "core/bounding_box.h"
+
+
+namespace Cubiq {
+
+    // Values of a function of x and y at the corners of square cells covering a bounding box. Corners lie on multiples
+    // of the cell size, so grids of neighbouring regions share their samples. Row 0 is at the bottom
+    class ValueGrid {
+
+    public:
+        ValueGrid(BoundingBox boundingBox, double precision);
+
+        // Evaluates the function at every corner, in parallel
+        void evaluate(const std::function<float(float, float)>& function);
+
+        int getWidth() const;  // In cells, so there is one more corner per row
+        int getHeight() const;
+        bool isEmpty() const;
+
+        float at(int xInd, int yInd) const;
+        float x(int xInd) const;
+        float y(int yInd) const;
+        double getCellSize() const;
+
+    private:
+        int width, height;
+        double precision;
+        double firstX, firstY; // Index of the first corner in multiples of the cell size
+        std::vector<float> values;
+
+    };
+
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <QCommandLineParser>
 
 #include "core/main_window.h"
+#include "core/trace.h"
 
 #include "style/dark_qss.h"
 
@@ -17,10 +18,32 @@ int main(int argc, char* argv[]) {
     QCommandLineParser parser;
     parser.setApplicationDescription(QCoreApplication::applicationName());
     parser.addHelpOption();
+    parser.addOption({"trace", "Record a Chrome trace from startup and write it on exit.", "file"});
+    parser.addOption({"replay", "Replay recorded input, then write a latency report and exit.", "recording"});
+    parser.addOption({"report", "Where to write the replay's report, instead of the standard output.", "file"});
     parser.process(app);
 
+    Cubiq::Trace::nameThread("GUI");
+    if (parser.isSet("trace")) Cubiq::Trace::start();
+
     Cubiq::MainWindow mainWin;
     mainWin.showMaximized();
 
-    return QApplication::exec();
+    if (parser.isSet("replay")) {
+        Cubiq::Interaction interaction;
+        QString error;
+        if (!Cubiq::Interaction::load(parser.value("replay"), interaction, error)) {
+            qWarning("Could not open the recording: %s", qPrintable(error));
+            return 1;
+        }
+        mainWin.replay(interaction, parser.isSet("report") ? parser.value("report") : "-");
+    }
+
+    int result = QApplication::exec();
+
+    QString error;
+    if (parser.isSet("trace") && !Cubiq::Trace::write(parser.value("trace"), error)) {
+        qWarning("Could not write the trace: %s", qPrintable(error));
+    }
+    return result;
 }
\ No newline at end of file
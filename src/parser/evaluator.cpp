@@ -0,0 +1,211 @@
+#include "evaluator.h"
+
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+
+namespace Cubiq::Parser {
+
+    const int CompiledExpression::MAX_STACK_SIZE = 64;
+
+
+    namespace {
+
+        struct FunctionInfo {
+            const char* name;
+            MathFunction function;
+        };
+
+        const FunctionInfo FUNCTIONS[] = {
+                {"\\sin",    [](double v) { return std::sin(v); }},
+                {"\\cos",    [](double v) { return std::cos(v); }},
+                {"\\tan",    [](double v) { return std::tan(v); }},
+                {"\\sec",    [](double v) { return 1 / std::cos(v); }},
+                {"\\csc",    [](double v) { return 1 / std::sin(v); }},
+                {"\\cot",    [](double v) { return 1 / std::tan(v); }},
+                {"\\arcsin", [](double v) { return std::asin(v); }},
+                {"\\arccos", [](double v) { return std::acos(v); }},
+                {"\\arctan", [](double v) { return std::atan(v); }},
+                {"\\sinh",   [](double v) { return std::sinh(v); }},
+                {"\\cosh",   [](double v) { return std::cosh(v); }},
+                {"\\tanh",   [](double v) { return std::tanh(v); }},
+                {"\\exp",    [](double v) { return std::exp(v); }},
+                {"\\ln",     [](double v) { return std::log(v); }},
+                {"\\log",    [](double v) { return std::log10(v); }},
+        };
+
+
+        double root(double index, double radicand) {
+            if (index == 2) return std::sqrt(radicand);
+            // Odd roots of negative numbers are real
+            if (radicand < 0 && std::fmod(index, 2) == 1) return -std::pow(-radicand, 1 / index);
+            return std::pow(radicand, 1 / index);
+        }
+
+    }
+
+
+    MathFunction findFunction(const std::string& name) {
+        for (const FunctionInfo& info : FUNCTIONS) {
+            if (name == info.name) return info.function;
+        }
+        return nullptr;
+    }
+
+    bool references(const Expression& expr, const std::string& name) {
+        if (expr.isSymbol()) return expr.getSymbol().name == name;
+        for (const Expression& child : expr.getChildren()) {
+            if (references(child, name)) return true;
+        }
+        return false;
+    }
+
+
+    CompiledExpression::CompiledExpression(const Expression& expr, std::vector<std::string> vars) :
+            expression(expr), variables(std::move(vars)), stackSize(0) {
+        compile(expr, 0);
+    }
+
+
+    const Expression& CompiledExpression::getExpression() const {
+        return expression;
+    }
+
+    const std::vector<std::string>& CompiledExpression::getVariables() const {
+        return variables;
+    }
+
+
+    void CompiledExpression::emit(Opcode opcode, int depth, double value, int index, double (* function)(double)) {
+        program.push_back({opcode, value, index, function});
+        stackSize = std::max(stackSize, depth + 1);
+    }
+
+    // Appends instructions leaving the value of the expression at the given stack depth
+    void CompiledExpression::compile(const Expression& expr, int depth) {
+        if (depth >= MAX_STACK_SIZE) throw Error{ErrorType::UNKNOWN_ERROR, "expression is nested too deeply"};
+
+        if (expr.isNumber()) {
+            emit(Opcode::CONSTANT, depth, expr.getNumber());
+            return;
+        }
+
+        if (expr.isSymbol()) {
+            const std::string& name = expr.getSymbol().name;
+            for (int i = 0; i < variables.size(); i++) {
+                if (variables[i] == name) {
+                    emit(Opcode::VARIABLE, depth, 0, i);
+                    return;
+                }
+            }
+            if (name == "\\pi") emit(Opcode::CONSTANT, depth, std::numbers::pi);
+            else if (name == "e") emit(Opcode::CONSTANT, depth, std::numbers::e);
+            else throw Error{ErrorType::BAD_TYPE, name};
+            return;
+        }
+
+        if (!expr.isOperation()) throw Error{ErrorType::EXPECTED_OPERAND, ""};
+
+        const std::vector<Expression>& children = expr.getChildren();
+        Operation operation = expr.getOperation();
+
+        if (operation == Operation::CALL) {
+            if (children.size() != 2) throw Error{ErrorType::BAD_TYPE, children.at(0).toString()};
+            if (children[0].isSymbol()) {
+                if (MathFunction function = findFunction(children[0].getSymbol().name)) {
+                    compile(children[1], depth);
+                    emit(Opcode::FUNCTION, depth, 0, 0, function);
+                    return;
+                }
+            }
+            // Anything else followed by parentheses is implicit multiplication
+            compile(children[0], depth);
+            compile(children[1], depth + 1);
+            emit(Opcode::MUL, depth);
+            return;
+        }
+
+        // Every other supported operation is unary or binary on numbers
+        for (int i = 0; i < children.size(); i++) {
+            compile(children[i], depth + i);
+        }
+
+        switch (operation) {
+            case Operation::POS: break;
+            case Operation::NEG: emit(Opcode::NEG, depth); break;
+            case Operation::ADD: emit(Opcode::ADD, depth); break;
+            case Operation::SUB: emit(Opcode::SUB, depth); break;
+            case Operation::MUL: emit(Opcode::MUL, depth); break;
+            case Operation::DIV: emit(Opcode::DIV, depth); break;
+            case Operation::MOD: emit(Opcode::MOD, depth); break;
+            case Operation::EXP: emit(Opcode::POW, depth); break;
+            case Operation::SQRT: emit(Opcode::ROOT, depth); break;
+            case Operation::FACT: emit(Opcode::FACT, depth); break;
+            case Operation::EQ: emit(Opcode::EQ, depth); break;
+            case Operation::NEQ: emit(Opcode::NEQ, depth); break;
+            case Operation::LT: emit(Opcode::LT, depth); break;
+            case Operation::GT: emit(Opcode::GT, depth); break;
+            case Operation::LTEQ: emit(Opcode::LTEQ, depth); break;
+            case Operation::GTEQ: emit(Opcode::GTEQ, depth); break;
+            case Operation::L_NOT: emit(Opcode::NOT, depth); break;
+            case Operation::L_AND: emit(Opcode::AND, depth); break;
+            case Operation::L_OR: emit(Opcode::OR, depth); break;
+            case Operation::L_XOR: emit(Opcode::XOR, depth); break;
+            default:
+                throw Error{ErrorType::BAD_TYPE, expr.toString()};
+        }
+    }
+
+
+    double CompiledExpression::evaluate(const double* args) const {
+        double stack[MAX_STACK_SIZE];
+        int top = -1;
+
+        for (const Instruction& in : program) {
+            switch (in.opcode) {
+                case Opcode::CONSTANT: stack[++top] = in.value; break;
+                case Opcode::VARIABLE: stack[++top] = args[in.index]; break;
+                case Opcode::FUNCTION: stack[top] = in.function(stack[top]); break;
+                case Opcode::NEG: stack[top] = -stack[top]; break;
+                case Opcode::FACT: stack[top] = std::tgamma(stack[top] + 1); break;
+                case Opcode::NOT: stack[top] = stack[top] == 0; break;
+                default: {
+                    double r = stack[top--];
+                    double& l = stack[top];
+                    switch (in.opcode) {
+                        case Opcode::ADD: l = l + r; break;
+                        case Opcode::SUB: l = l - r; break;
+                        case Opcode::MUL: l = l * r; break;
+                        case Opcode::DIV: l = l / r; break;
+                        case Opcode::MOD: l = l - r * std::floor(l / r); break;
+                        case Opcode::POW: l = std::pow(l, r); break;
+                        case Opcode::ROOT: l = root(l, r); break;
+                        case Opcode::EQ: l = l == r; break;
+                        case Opcode::NEQ: l = l != r; break;
+                        case Opcode::LT: l = l < r; break;
+                        case Opcode::GT: l = l > r; break;
+                        case Opcode::LTEQ: l = l <= r; break;
+                        case Opcode::GTEQ: l = l >= r; break;
+                        case Opcode::AND: l = l != 0 && r != 0; break;
+                        case Opcode::OR: l = l != 0 || r != 0; break;
+                        case Opcode::XOR: l = (l != 0) != (r != 0); break;
+                        default: break;
+                    }
+                }
+            }
+        }
+
+        return stack[0];
+    }
+
+    double CompiledExpression::evaluate(double a) const {
+        return evaluate(&a);
+    }
+
+    double CompiledExpression::evaluate(double a, double b) const {
+        double args[] = {a, b};
+        return evaluate(args);
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "expression.h"
+
+
+namespace Cubiq::Parser {
+
+    // A numeric expression flattened into a stack program, so it can be evaluated many times without walking the
+    // parse tree. Evaluation is const and allocation-free, so a single instance can be shared between threads.
+    class CompiledExpression {
+
+    public:
+        static const int MAX_STACK_SIZE;
+
+        // Variables are bound to evaluate() arguments in the given order. Throws Error if the expression uses
+        // anything that cannot be evaluated as a number
+        CompiledExpression(const Expression& expr, std::vector<std::string> vars);
+
+        double evaluate(const double* args) const;
+        double evaluate(double a) const;
+        double evaluate(double a, double b) const;
+
+        const Expression& getExpression() const;
+        const std::vector<std::string>& getVariables() const;
+
+    private:
+        enum struct Opcode {
+            CONSTANT, VARIABLE, FUNCTION,
+            NEG, ADD, SUB, MUL, DIV, MOD, POW, ROOT, FACT,
+            EQ, NEQ, LT, GT, LTEQ, GTEQ,
+            NOT, AND, OR, XOR,
+        };
+
+        struct Instruction {
+            Opcode opcode;
+            double value;
+            int index;
+            double (* function)(double);
+        };
+
+        Expression expression;
+        std::vector<std::string> variables;
+        std::vector<Instruction> program;
+        int stackSize;
+
+        void compile(const Expression& expr, int depth);
+        void emit(Opcode opcode, int depth, double value = 0, int index = 0, double (* function)(double) = nullptr);
+
+    };
+
+
+    using MathFunction = double (*)(double);
+
+    // Returns the built-in function with the given name (e.g. "\sin"), or nullptr if there is none
+    MathFunction findFunction(const std::string& name);
+
+    // Whether the expression refers to the given symbol anywhere
+    bool references(const Expression& expr, const std::string& name);
+
+}
\ No newline at end of file
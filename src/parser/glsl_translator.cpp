@@ -0,0 +1,156 @@
+#include "glsl_translator.h"
+
+#include <cmath>
+#include <charconv>
+#include <algorithm>
+
+
+namespace Cubiq::Parser {
+
+    namespace {
+
+        struct FunctionName {
+            const char* name;
+            const char* glsl;
+        };
+
+        // Every function findFunction() knows, by the name it has in the shader
+        const FunctionName FUNCTIONS[] = {
+                {"\\sin",    "sin"},
+                {"\\cos",    "cos"},
+                {"\\tan",    "tan"},
+                {"\\sec",    "sec"},
+                {"\\csc",    "csc"},
+                {"\\cot",    "cot"},
+                {"\\arcsin", "asin"},
+                {"\\arccos", "acos"},
+                {"\\arctan", "atan"},
+                {"\\sinh",   "sinh"},
+                {"\\cosh",   "cosh"},
+                {"\\tanh",   "tanh"},
+                {"\\exp",    "exp"},
+                {"\\ln",     "log"},
+                {"\\log",    "log10"},
+        };
+
+        // Shaders calculate in single precision, so numbers that only fit a double cannot be drawn there
+        std::string literal(double number) {
+            const auto value = (float) number;
+            if (!std::isfinite(value)) throw Error{ErrorType::BAD_TYPE, std::to_string(number)};
+
+            char buffer[32];
+            auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            std::string text(buffer, end);
+            // Integer literals are ints in GLSL, which do not mix with floats
+            if (text.find_first_of(".e") == std::string::npos) text += ".0";
+            return text;
+        }
+
+        void translate(const Expression& expr, const std::vector<std::string>& vars, std::string& out) {
+            if (expr.isNumber()) {
+                out += literal(expr.getNumber());
+                return;
+            }
+
+            if (expr.isSymbol()) {
+                const std::string& name = expr.getSymbol().name;
+                if (std::find(vars.begin(), vars.end(), name) != vars.end()) out += name;
+                else if (name == "\\pi") out += "3.14159265";
+                else if (name == "e") out += "2.71828183";
+                else throw Error{ErrorType::BAD_TYPE, name};
+                return;
+            }
+
+            if (!expr.isOperation()) throw Error{ErrorType::EXPECTED_OPERAND, ""};
+
+            const std::vector<Expression>& children = expr.getChildren();
+            const Operation operation = expr.getOperation();
+
+            auto call = [&](const char* function) {
+                out += function;
+                out += '(';
+                for (int i = 0; i < children.size(); i++) {
+                    if (i > 0) out += ", ";
+                    translate(children[i], vars, out);
+                }
+                out += ')';
+            };
+            auto binary = [&](const char* op) {
+                out += '(';
+                translate(children.at(0), vars, out);
+                out += op;
+                translate(children.at(1), vars, out);
+                out += ')';
+            };
+            // Comparisons and logic evaluate to 0 or 1, as on the CPU
+            auto condition = [&](const char* op, bool truth) {
+                out += "float(";
+                translate(children.at(0), vars, out);
+                out += truth ? " != 0.0" : "";
+                out += op;
+                translate(children.at(1), vars, out);
+                out += truth ? " != 0.0)" : ")";
+            };
+
+            if (operation == Operation::CALL) {
+                if (children.size() != 2) throw Error{ErrorType::BAD_TYPE, children.at(0).toString()};
+                if (children[0].isSymbol()) {
+                    const std::string& name = children[0].getSymbol().name;
+                    for (const FunctionName& function : FUNCTIONS) {
+                        if (name != function.name) continue;
+                        out += function.glsl;
+                        out += '(';
+                        translate(children[1], vars, out);
+                        out += ')';
+                        return;
+                    }
+                }
+                // Anything else followed by parentheses is implicit multiplication
+                binary(" * ");
+                return;
+            }
+
+            switch (operation) {
+                case Operation::POS: translate(children.at(0), vars, out); break;
+                case Operation::NEG:
+                    out += "(-";
+                    translate(children.at(0), vars, out);
+                    out += ')';
+                    break;
+                case Operation::ADD: binary(" + "); break;
+                case Operation::SUB: binary(" - "); break;
+                case Operation::MUL: binary(" * "); break;
+                case Operation::DIV: binary(" / "); break;
+                case Operation::MOD: call("mod"); break; // Floored, like the CPU's
+                case Operation::EXP: call("power"); break;
+                case Operation::SQRT: call("root"); break;
+                case Operation::EQ: condition(" == ", false); break;
+                case Operation::NEQ: condition(" != ", false); break;
+                case Operation::LT: condition(" < ", false); break;
+                case Operation::GT: condition(" > ", false); break;
+                case Operation::LTEQ: condition(" <= ", false); break;
+                case Operation::GTEQ: condition(" >= ", false); break;
+                case Operation::L_AND: condition(" && ", true); break;
+                case Operation::L_OR: condition(" || ", true); break;
+                case Operation::L_XOR: condition(" ^^ ", true); break;
+                case Operation::L_NOT:
+                    out += "float(";
+                    translate(children.at(0), vars, out);
+                    out += " == 0.0)";
+                    break;
+                default:
+                    // e.g. factorials, which would need a gamma function
+                    throw Error{ErrorType::BAD_TYPE, expr.toString()};
+            }
+        }
+
+    }
+
+
+    std::string translateToGLSL(const Expression& expr, const std::vector<std::string>& vars) {
+        std::string out;
+        translate(expr, vars, out);
+        return out;
+    }
+
+}
\ No newline at end of file
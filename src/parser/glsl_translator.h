@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "expression.h"
+
+
+namespace Cubiq::Parser {
+
+    // Translates a numeric expression into a single GLSL expression, with the variables named as given. Functions GLSL
+    // lacks are called by the names the implicit equation shader defines them under, with the same definitions as
+    // CompiledExpression. Throws Error if anything has no GLSL equivalent, so the caller can evaluate it on the CPU
+    std::string translateToGLSL(const Expression& expr, const std::vector<std::string>& vars);
+
+}
\ No newline at end of file
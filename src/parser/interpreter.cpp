@@ -1,4 +1,5 @@
 #include "interpreter.h"
+#include "evaluator.h"
 
 #include <stack>
 #include <iostream>
@@ -224,7 +225,7 @@ namespace Cubiq::Parser {
                 return std::isalpha(s[0]);
             }
             // TODO: better checking
-            return s == "\\pi" || s == "\\theta" || s == "\\omega";
+            return s == "\\pi" || s == "\\theta" || s == "\\omega" || findFunction(s) != nullptr;
         }
 
 
@@ -277,10 +278,13 @@ namespace Cubiq::Parser {
                         if (!it->isSymbol() || it->getSymbol().name != "\\right)") {
                             if (it->isSymbol() && it->getSymbol().name == ",") {
                                 // Parentheses represent point, not grouping
+                                ++it;
                                 operandStack.push(parseExpression(context, it, false));
                                 if (!it->isSymbol() || it->getSymbol().name != "\\right)")
                                     throw Error{ErrorType::MISSING, "\\right)"};
+                                // Complete already, so no operator after it can take its second coordinate
                                 operatorStack.push(OperatorInfo(Operation::POINT));
+                                popOperator(operatorStack, operandStack, context);
                             } else throw Error{ErrorType::MISSING, "\\right)"};
                         }
                         expectingOperand = false;
@@ -340,7 +344,7 @@ namespace Cubiq::Parser {
                             ++it;
                         } else {
                             // Defaults to square root
-                            operandStack.emplace(context, 2, std::vector<Expression>());
+                            operandStack.emplace(context, Number(2), std::vector<Expression>());
                         }
                         if (!it->isSymbol() || it->getSymbol().name != "{")
                             throw Error{ErrorType::MISSING, "{"};
@@ -69,9 +69,7 @@ namespace Cubiq::Parser {
 
     namespace {
 
-        int firstChar = 0;
-
-        Token grabSymbol(CharStream& stream, int c) {
+        Token grabSymbol(CharStream& stream, int& firstChar, int c) {
             std::string word;
 
             if (c == '\\') {
@@ -103,7 +101,7 @@ namespace Cubiq::Parser {
         }
 
 
-        Token grabNumber(CharStream& stream, int c) {
+        Token grabNumber(CharStream& stream, int& firstChar, int c) {
             std::string word;
             if (firstChar == '.') word += ".";
             bool isInteger = c != '.' && firstChar != '.';
@@ -123,7 +121,7 @@ namespace Cubiq::Parser {
         }
 
 
-        Token tokenize(CharStream& stream) {
+        Token tokenize(CharStream& stream, int& firstChar) {
             if (firstChar == 0) firstChar = stream();
 
             while (true) {
@@ -133,14 +131,14 @@ namespace Cubiq::Parser {
                     firstChar = stream();
                     continue;
                 } else if (std::isdigit(firstChar)) {
-                    return grabNumber(stream, firstChar);
+                    return grabNumber(stream, firstChar, firstChar);
                 } else if (firstChar == '.') {
                     int c = stream();
-                    if (std::isdigit(c)) return grabNumber(stream, c);
+                    if (std::isdigit(c)) return grabNumber(stream, firstChar, c);
                     firstChar = c;
                     return {Symbol{"."}};
                 } else {
-                    return grabSymbol(stream, firstChar);
+                    return grabSymbol(stream, firstChar, firstChar);
                 }
             }
         }
@@ -148,12 +146,12 @@ namespace Cubiq::Parser {
     }
 
 
-    TokenIterator::TokenIterator(CharStream& stream) : charStream(stream), current(Empty()) {
+    TokenIterator::TokenIterator(CharStream& stream) : charStream(stream), nextChar(0), current(Empty()) {
         ++(*this);
     }
 
     TokenIterator& TokenIterator::operator++() {
-        current = tokenize(charStream);
+        current = tokenize(charStream, nextChar);
         return *this;
     }
 
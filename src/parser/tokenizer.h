@@ -56,6 +56,7 @@ namespace Cubiq::Parser {
 
     private:
         CharStream& charStream;
+        int nextChar; // First character of the next token, already read from the stream
         Token current;
     
     public:
@@ -0,0 +1,210 @@
+#include "figure_renderer.h"
+
+#include <cmath>
+#include <QImage>
+#include <QPainterPath>
+#include <QSvgGenerator>
+
+
+namespace Cubiq {
+
+    const float FigureRenderer::MINOR_ALPHA = 0.05f;
+    const float FigureRenderer::MAJOR_ALPHA = 0.2f;
+    const float FigureRenderer::AXIS_ALPHA = 0.5f;
+
+    namespace {
+
+        const QColor BACKGROUND = QColor::fromRgbF(0.133, 0.133, 0.133); // Same as the view's clear color
+
+        // Runs of each color in a snapshot's vertices, which are all in the equation's color unless it has several
+        std::vector<Equation::ColorRun> colorRuns(const std::vector<Equation::ColorRun>& colors, unsigned long numFloats,
+                                                  const Equation::DisplaySettings& ds) {
+            if (!colors.empty()) return colors;
+            return {{numFloats / Equation::FLOATS_PER_VERTEX, ds.r, ds.g, ds.b, ds.a}};
+        }
+
+    }
+
+
+    FigureRenderer::FigureRenderer(int width, int height, double sampleWidth) :
+            width(width), height(height), sampleWidth(sampleWidth) {}
+
+    bool FigureRenderer::render(Graph& graph, const BoundingBox& viewport, Format format, const QString& path, QString& error) const {
+        const BoundingBox visible = viewport.width() > 0 && viewport.height() > 0
+                                    ? viewport
+                                    : graph.getBoundingBox().withAspect((float) height / (float) width);
+
+        if (format == Format::SVG) {
+            QSvgGenerator generator;
+            generator.setFileName(path);
+            generator.setSize(QSize(width, height));
+            generator.setViewBox(QRect(0, 0, width, height));
+            generator.setTitle(graph.getName());
+            generator.setDescription(graph.getDescription());
+
+            QPainter painter;
+            if (!painter.begin(&generator)) {
+                error = "Could not write " + path;
+                return false;
+            }
+            paint(painter, graph, graph.computeViewport(visible, width, height, sampleWidth), visible);
+            return painter.end();
+        }
+
+        if (!renderImage(graph, visible).save(path, "PNG")) {
+            error = "Could not write " + path;
+            return false;
+        }
+        return true;
+    }
+
+
+    // The graph's own snapshots are left alone, so several threads can render the same graph
+    QImage FigureRenderer::renderImage(Graph& graph, const BoundingBox& visible) const {
+        const std::vector<Graph::Snapshot> snapshots = graph.computeViewport(visible, width, height, sampleWidth);
+
+        QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+        QPainter painter(&image);
+        paint(painter, graph, snapshots, visible);
+        painter.end();
+        return image;
+    }
+
+
+    void FigureRenderer::paint(QPainter& painter, Graph& graph, const std::vector<Graph::Snapshot>& snapshots,
+                               const BoundingBox& visible) const {
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.fillRect(QRect(0, 0, width, height), BACKGROUND);
+
+        if (graph.hasGrid()) paintGrid(painter, visible);
+
+        const auto& equations = graph.getEquations();
+        for (size_t i = 0; i < equations.size() && i < snapshots.size(); i++) {
+            const Equation::DisplaySettings& ds = equations[i]->getDisplaySettings();
+            paintDensity(painter, snapshots[i], ds, visible);
+            paintFill(painter, snapshots[i], ds, visible);
+            paintSegments(painter, snapshots[i], ds, visible);
+        }
+    }
+
+    void FigureRenderer::paintGrid(QPainter& painter, const BoundingBox& visible) const {
+        const double pixelSizeX = visible.width() / width;
+        const double pixelSizeY = visible.height() / height;
+
+        double spaceX, spaceY;
+        int majorX, majorY;
+        gridSpacing(pixelSizeX, spaceX, majorX);
+        gridSpacing(pixelSizeY, spaceY, majorY);
+
+        // Minor lines first, so major lines and axes are drawn over them
+        auto drawLines = [&](float alpha, qreal lineWidth, auto&& select) {
+            painter.setPen(QPen(QColor::fromRgbF(1, 1, 1, alpha), lineWidth, Qt::SolidLine, Qt::FlatCap));
+            for (long i = (long) std::ceil(visible.minX / spaceX); i <= (long) std::floor(visible.maxX / spaceX); i++) {
+                if (!select(i, majorX)) continue;
+                qreal x = (i * spaceX - visible.minX) / pixelSizeX;
+                painter.drawLine(QLineF(x, 0, x, height));
+            }
+            for (long i = (long) std::ceil(visible.minY / spaceY); i <= (long) std::floor(visible.maxY / spaceY); i++) {
+                if (!select(i, majorY)) continue;
+                qreal y = (visible.maxY - i * spaceY) / pixelSizeY;
+                painter.drawLine(QLineF(0, y, width, y));
+            }
+        };
+
+        drawLines(MINOR_ALPHA, 1, [](long i, int major) { return i % major != 0; });
+        drawLines(MAJOR_ALPHA, 1, [](long i, int major) { return i % major == 0 && i != 0; });
+        drawLines(AXIS_ALPHA, 2, [](long i, int) { return i == 0; });
+    }
+
+    void FigureRenderer::paintDensity(QPainter& painter, const Graph::Snapshot& snapshot,
+                                      const Equation::DisplaySettings& ds, const BoundingBox& visible) const {
+        if (snapshot.density.empty()) return;
+
+        // Coverage of the equation's color, with the rows flipped since row 0 of the density is at minY
+        QImage image(snapshot.densityWidth, snapshot.densityHeight, QImage::Format_ARGB32);
+        for (int y = 0; y < snapshot.densityHeight; y++) {
+            const unsigned char* src = snapshot.density.data() + (size_t) y * snapshot.densityWidth;
+            auto* dst = (QRgb*) image.scanLine(snapshot.densityHeight - 1 - y);
+            for (int x = 0; x < snapshot.densityWidth; x++) {
+                dst[x] = qRgba((int) (ds.r * 255), (int) (ds.g * 255), (int) (ds.b * 255), (int) (ds.a * (float) src[x]));
+            }
+        }
+
+        const double pixelSizeX = visible.width() / width;
+        const double pixelSizeY = visible.height() / height;
+        const BoundingBox& bounds = snapshot.bounds;
+        QRectF target((bounds.minX - visible.minX) / pixelSizeX, (visible.maxY - bounds.maxY) / pixelSizeY,
+                      bounds.width() / pixelSizeX, bounds.height() / pixelSizeY);
+        painter.drawImage(target, image);
+    }
+
+    // All triangles of a color are filled as one path, so antialiasing leaves no seams where they meet
+    void FigureRenderer::paintFill(QPainter& painter, const Graph::Snapshot& snapshot,
+                                   const Equation::DisplaySettings& ds, const BoundingBox& visible) const {
+        if (snapshot.fill.empty()) return;
+
+        const double pixelSizeX = visible.width() / width;
+        const double pixelSizeY = visible.height() / height;
+
+        unsigned long first = 0;
+        for (const Equation::ColorRun& run: colorRuns(snapshot.fillColors, snapshot.fill.size(), ds)) {
+            QPainterPath path;
+            path.setFillRule(Qt::WindingFill);
+            const float* vertices = snapshot.fill.data() + first * Equation::FLOATS_PER_VERTEX;
+            for (unsigned long v = 0; v + 2 < run.count; v += 3) {
+                for (int k = 0; k < 3; k++) {
+                    const float* p = vertices + (v + k) * Equation::FLOATS_PER_VERTEX;
+                    QPointF corner((p[0] - visible.minX) / pixelSizeX, (visible.maxY - p[1]) / pixelSizeY);
+                    if (k == 0) path.moveTo(corner);
+                    else path.lineTo(corner);
+                }
+                path.closeSubpath();
+            }
+
+            painter.fillPath(path, QColor::fromRgbF(run.r, run.g, run.b, run.a * Equation::FILL_ALPHA));
+            first += run.count;
+        }
+    }
+
+    void FigureRenderer::paintSegments(QPainter& painter, const Graph::Snapshot& snapshot,
+                                       const Equation::DisplaySettings& ds, const BoundingBox& visible) const {
+        const double pixelSizeX = visible.width() / width;
+        const double pixelSizeY = visible.height() / height;
+
+        unsigned long first = 0;
+        for (const Equation::ColorRun& run: colorRuns(snapshot.colors, snapshot.size(), ds)) {
+            // Zero-length segments are points, which the view draws as dots
+            QVector<QLineF> lines;
+            QVector<QPointF> points;
+            const float* vertices = snapshot.data() + first * Equation::FLOATS_PER_VERTEX;
+            for (unsigned long v = 0; v + 1 < run.count; v += 2) {
+                const float* a = vertices + v * Equation::FLOATS_PER_VERTEX;
+                const float* b = a + Equation::FLOATS_PER_VERTEX;
+                QPointF p((a[0] - visible.minX) / pixelSizeX, (visible.maxY - a[1]) / pixelSizeY);
+                QPointF q((b[0] - visible.minX) / pixelSizeX, (visible.maxY - b[1]) / pixelSizeY);
+                if (p == q) {
+                    points.append(p);
+                } else {
+                    lines.append(QLineF(p, q));
+                }
+            }
+
+            painter.setPen(QPen(QColor::fromRgbF(run.r, run.g, run.b, run.a), ds.lineWidth, Qt::SolidLine, Qt::RoundCap));
+            if (!lines.isEmpty()) painter.drawLines(lines);
+            if (!points.isEmpty()) painter.drawPoints(points.data(), (int) points.size());
+            first += run.count;
+        }
+    }
+
+
+    // Same 1, 2, 5 steps as the view
+    void FigureRenderer::gridSpacing(double pixelSize, double& space, int& major) {
+        const double decade = std::pow(10.0, std::floor(std::log10(20.0 * pixelSize)));
+        for (double base: {1.0, 2.0, 5.0, 10.0}) {
+            space = base * decade;
+            major = base == 5.0 ? 4 : 5;
+            if (space / pixelSize >= 20.0) return;
+        }
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <QString>
+#include <QImage>
+#include <QPainter>
+
+#include "core/graph.h"
+
+
+namespace Cubiq {
+
+    // Draws a graph the way the view does, but with QPainter instead of OpenGL, so figures can be produced without a
+    // window or a GPU
+    class FigureRenderer {
+
+    public:
+        enum class Format {
+            PNG,
+            SVG,
+        };
+
+        static const float MINOR_ALPHA;
+        static const float MAJOR_ALPHA;
+        static const float AXIS_ALPHA;
+
+        FigureRenderer(int width, int height, double sampleWidth);
+
+        // Calculates the graph for the viewport, or for its own bounding box if the viewport is empty, and writes
+        // the image to the path. Returns false and sets the error if the file could not be written
+        bool render(Graph& graph, const BoundingBox& viewport, Format format, const QString& path, QString& error) const;
+        // Draws exactly the visible area, calculating the graph on the calling thread
+        QImage renderImage(Graph& graph, const BoundingBox& visible) const;
+
+    private:
+        int width, height;
+        double sampleWidth; // In pixels
+
+        void paint(QPainter& painter, Graph& graph, const std::vector<Graph::Snapshot>& snapshots,
+                   const BoundingBox& visible) const;
+        void paintGrid(QPainter& painter, const BoundingBox& visible) const;
+        void paintDensity(QPainter& painter, const Graph::Snapshot& snapshot, const Equation::DisplaySettings& ds,
+                          const BoundingBox& visible) const;
+        void paintFill(QPainter& painter, const Graph::Snapshot& snapshot, const Equation::DisplaySettings& ds,
+                       const BoundingBox& visible) const;
+        void paintSegments(QPainter& painter, const Graph::Snapshot& snapshot, const Equation::DisplaySettings& ds,
+                           const BoundingBox& visible) const;
+
+        // Minor grid spacing in graph units, 20 to 50 pixels apart, and the number of minor lines per major line
+        static void gridSpacing(double pixelSize, double& space, int& major);
+
+    };
+
+}
\ No newline at end of file
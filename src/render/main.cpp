@@ -0,0 +1,130 @@
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QThreadPool>
+#include <QTextStream>
+
+#include "core/graph_file.h"
+#include "equations/placeholder.h"
+#include "render/figure_renderer.h"
+
+
+namespace {
+
+    bool parseViewport(const QString& text, Cubiq::BoundingBox& viewport) {
+        const QStringList parts = text.split(',');
+        if (parts.size() != 4) return false;
+
+        float values[4];
+        for (int i = 0; i < 4; i++) {
+            bool ok;
+            values[i] = parts[i].trimmed().toFloat(&ok);
+            if (!ok) return false;
+        }
+        viewport = {values[0], values[1], values[2], values[3]};
+        return viewport.width() > 0 && viewport.height() > 0;
+    }
+
+}
+
+
+// Renders graph files to images without a window, e.g. to produce figures for a report in bulk
+int main(int argc, char* argv[]) {
+    // QPainter needs a GUI application, but never a display
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("Cubiq");
+    QCoreApplication::setApplicationName("Grapher Render");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders graph files to PNG or SVG images");
+    parser.addHelpOption();
+    parser.addPositionalArgument("inputs", "Graph files, or directories of them", "<inputs...>");
+    parser.addOptions({
+            {{"o", "output"}, "Directory to write images to. Defaults to next to each graph file", "dir"},
+            {{"f", "format"}, "Image format, png or svg", "format", "png"},
+            {{"s", "size"}, "Image size in pixels", "WxH", "1920x1080"},
+            {"viewport", "Area to draw instead of each graph's own view", "minX,maxX,minY,maxY"},
+            {"sample-width", "Pixels between samples, as in the view's quality setting", "pixels", "1"},
+            {{"j", "jobs"}, "Number of graphs to render at once", "count", QString::number(QThread::idealThreadCount())},
+    });
+    parser.process(app);
+
+    QTextStream err(stderr);
+    auto fail = [&err](const QString& message) {
+        err << message << Qt::endl;
+        return 2;
+    };
+
+    const QStringList inputs = Cubiq::findGraphFiles(parser.positionalArguments());
+    if (inputs.isEmpty()) return fail("No graph files given");
+
+    const QString formatName = parser.value("format").toLower();
+    if (formatName != "png" && formatName != "svg") return fail("Unknown format: " + formatName);
+    const auto format = formatName == "svg" ? Cubiq::FigureRenderer::Format::SVG : Cubiq::FigureRenderer::Format::PNG;
+
+    const QStringList size = parser.value("size").split('x');
+    int width = 0, height = 0;
+    if (size.size() == 2) {
+        width = size[0].toInt();
+        height = size[1].toInt();
+    }
+    if (width <= 0 || height <= 0) return fail("Invalid size: " + parser.value("size"));
+
+    Cubiq::BoundingBox viewport{0, 0, 0, 0};
+    if (parser.isSet("viewport") && !parseViewport(parser.value("viewport"), viewport)) {
+        return fail("Invalid viewport: " + parser.value("viewport"));
+    }
+
+    bool ok;
+    const double sampleWidth = parser.value("sample-width").toDouble(&ok);
+    if (!ok || sampleWidth <= 0) return fail("Invalid sample width: " + parser.value("sample-width"));
+    const int jobs = parser.value("jobs").toInt(&ok);
+    if (!ok || jobs <= 0) return fail("Invalid job count: " + parser.value("jobs"));
+
+    const QString outputDir = parser.value("output");
+    if (!outputDir.isEmpty() && !QDir().mkpath(outputDir)) return fail("Could not create " + outputDir);
+
+    const Cubiq::FigureRenderer renderer(width, height, sampleWidth);
+
+    // Each graph is calculated on its own thread, and its equations in parallel within it
+    std::mutex errMutex;
+    std::atomic<int> failures = 0;
+    QThreadPool pool;
+    pool.setMaxThreadCount(jobs);
+
+    for (const QString& input: inputs) {
+        pool.start([&, input]() {
+            QFileInfo info(input);
+            const QString dir = outputDir.isEmpty() ? info.absolutePath() : outputDir;
+            const QString output = QDir(dir).filePath(info.completeBaseName() + "." + formatName);
+
+            QString error;
+            std::unique_ptr<Cubiq::Graph> graph(Cubiq::loadGraph(input, error));
+            const bool rendered = graph && renderer.render(*graph, viewport, format, output, error);
+
+            std::lock_guard<std::mutex> lock(errMutex);
+            if (!rendered) {
+                err << input << ": " << error << Qt::endl;
+                failures++;
+                return;
+            }
+
+            // Elements that failed to compile are drawn as nothing, which is worth knowing about
+            for (const auto& equation: graph->getEquations()) {
+                if (auto* placeholder = dynamic_cast<const Cubiq::Placeholder*>(equation.get())) {
+                    err << input << ": " << QString::fromStdString(placeholder->getError()) << Qt::endl;
+                }
+            }
+            err << input << " -> " << output << Qt::endl;
+        });
+    }
+    pool.waitForDone();
+
+    return failures > 0 ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <iostream>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include "core/graph_file.h"
+#include "core/calculation_loop.h"
+#include "core/interaction.h"
+
+
+namespace {
+
+    long long steadyMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+}
+
+
+// Replays recorded input against a graph without a window, drawing nothing but timing frames at a fixed rate, so
+// input-to-geometry latency can be compared between builds and machines
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("Cubiq");
+    QCoreApplication::setApplicationName("Grapher Replay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays recorded input and reports how quickly geometry follows it, as JSON");
+    parser.addHelpOption();
+    parser.addPositionalArgument("recording", "Input recorded in the grapher", "<recording>");
+    parser.addOptions({
+            {"graph", "Graph file to replay on, instead of the one the input was recorded on", "file"},
+            {"sample-width", "Pixels between samples, as in the view's quality setting", "pixels", "3"},
+            {"frame-budget", "Calculation time per frame while interacting, as in the view's quality setting", "millis", "16"},
+            {"frame-rate", "Frames per second to draw at", "fps", "60"},
+            {"report", "File to write the report to, instead of the standard output", "file"},
+    });
+    parser.process(app);
+
+    QTextStream err(stderr);
+    auto fail = [&err](const QString& message) {
+        err << message << Qt::endl;
+        return 2;
+    };
+
+    if (parser.positionalArguments().size() != 1) return fail("Expected one recording");
+
+    QString error;
+    Cubiq::Interaction interaction;
+    if (!Cubiq::Interaction::load(parser.positionalArguments().first(), interaction, error)) {
+        return fail("Could not open the recording: " + error);
+    }
+
+    const QString graphPath = parser.isSet("graph") ? parser.value("graph") : interaction.graphPath;
+    if (graphPath.isEmpty()) return fail("The recording was made on an unsaved graph, so --graph is needed");
+    std::unique_ptr<Cubiq::Graph> graph(Cubiq::loadGraph(graphPath, error));
+    if (!graph) return fail(graphPath + ": " + error);
+
+    bool ok;
+    const double sampleWidth = parser.value("sample-width").toDouble(&ok);
+    if (!ok || sampleWidth <= 0) return fail("Invalid sample width: " + parser.value("sample-width"));
+    const double frameBudget = parser.value("frame-budget").toDouble(&ok);
+    if (!ok || frameBudget <= 0) return fail("Invalid frame budget: " + parser.value("frame-budget"));
+    const double frameRate = parser.value("frame-rate").toDouble(&ok);
+    if (!ok || frameRate <= 0) return fail("Invalid frame rate: " + parser.value("frame-rate"));
+
+    const auto frameMicros = (long long) (1e6 / frameRate);
+    const std::vector<Cubiq::Interaction::Event>& events = interaction.events;
+
+    // The starting view is calculated before the clock starts, as it would be on screen before recording
+    graph->setBoundingBox(events.front().bounds);
+    // Geometry follows the view the way it does on screen, as the view's own calculation loop is used
+    const int width = interaction.width, height = interaction.height;
+    Cubiq::CalculationLoop calculator(graph.get(), sampleWidth, frameBudget,
+            [width, height](Cubiq::Graph& shown, Cubiq::BoundingBox& visible, double& pixelSize) {
+                visible = shown.getBoundingBox().withAspect((float) height / (float) width);
+                pixelSize = (double) visible.width() / width;
+                return true;
+            }, [] {});
+    const unsigned long initial = calculator.markToUpdate();
+    while (calculator.getHandledSerial() < initial) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    Cubiq::LatencyRecorder latency(1000.0 / frameRate);
+    unsigned long next = 1;
+    const long long start = steadyMicros();
+    long long frame = start;
+
+    while (true) {
+        const long long now = steadyMicros();
+        const long long elapsed = (now - start) / 1000;
+        while (next < events.size() && events[next].millis <= elapsed) {
+            graph->setBoundingBox(events[next++].bounds);
+            latency.input(calculator.markToUpdate(), now);
+        }
+
+        // Drawing holds the graph's mutex, as the view does, so swapping in new geometry delays frames the same way
+        const unsigned long handled = calculator.getHandledSerial();
+        graph->getMutex().lock();
+        graph->getMutex().unlock();
+        latency.frame(handled, steadyMicros());
+
+        // Ends once the last input is drawn, or gives up a while after
+        const bool applied = next == events.size();
+        const bool timedOut = elapsed > events.back().millis + Cubiq::LatencyRecorder::TIMEOUT_MILLIS;
+        if (applied && (latency.isSettled() || timedOut)) break;
+
+        // Frames are only ever shown on the next period, like with vertical sync
+        const long long after = steadyMicros();
+        while (frame <= after) frame += frameMicros;
+        std::this_thread::sleep_for(std::chrono::microseconds(frame - after));
+    }
+
+    QJsonObject report = latency.report();
+    report["width"] = interaction.width;
+    report["height"] = interaction.height;
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    if (!parser.isSet("report")) {
+        std::cout << json.toStdString() << std::flush;
+        return 0;
+    }
+
+    QSaveFile file(parser.value("report"));
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) < 0 || !file.commit()) {
+        return fail("Could not write the report: " + file.errorString());
+    }
+    return 0;
+}
\ No newline at end of file
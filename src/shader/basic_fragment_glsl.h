@@ -2,15 +2,14 @@
 // NOTE: The #version directive is automatically inserted at runtime according to user's GLSL version.
 const char* BASIC_FRAGMENT_GLSL = R"(
 #if __VERSION__ >= 130
-    #define varying in
     out vec4 color;
 #else
     #define color gl_FragColor
 #endif
 
-varying vec4 fColor;
+uniform vec4 uColor;
 
 void main() {
-    color = fColor;
+    color = uColor;
 }
 )";
\ No newline at end of file
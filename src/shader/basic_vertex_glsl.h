@@ -3,18 +3,13 @@
 const char* BASIC_VERTEX_GLSL = R"(
 #if __VERSION__ >= 130
     #define attribute in
-    #define varying out
 #endif
 
-attribute vec3 vPos;
-attribute vec4 vColor;
+attribute vec2 vPos;
 
 uniform mat4 uProjection;
 
-varying vec4 fColor;
-
 void main() {
-    fColor = vColor;
-    gl_Position = uProjection * vec4(vPos, 1);
+    gl_Position = uProjection * vec4(vPos, 0, 1);
 }
 )";
\ No newline at end of file
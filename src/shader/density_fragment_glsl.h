@@ -0,0 +1,21 @@
+// This is a header file serving only to hold GLSL code.
+// NOTE: The #version directive is automatically inserted at runtime according to user's GLSL version.
+const char* DENSITY_FRAGMENT_GLSL = R"(
+#if __VERSION__ >= 130
+    #define varying in
+    #define texture2D texture
+    out vec4 color;
+#else
+    #define color gl_FragColor
+#endif
+
+varying vec2 fTexCoord;
+
+uniform sampler2D uDensity;
+uniform vec4 uColor;
+
+void main() {
+    // The tone-mapped density is the coverage of the equation's color
+    color = vec4(uColor.rgb, uColor.a * texture2D(uDensity, fTexCoord).r);
+}
+)";
\ No newline at end of file
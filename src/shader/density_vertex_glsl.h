@@ -0,0 +1,21 @@
+// This is a header file serving only to hold GLSL code.
+// NOTE: The #version directive is automatically inserted at runtime according to user's GLSL version.
+const char* DENSITY_VERTEX_GLSL = R"(
+#if __VERSION__ >= 130
+    #define attribute in
+    #define varying out
+#endif
+
+attribute vec2 vPos;
+
+uniform mat4 uProjection;
+uniform vec4 uBounds; // minX, maxX, minY, maxY
+
+varying vec2 fTexCoord;
+
+void main() {
+    // Stretch the unit quad over the region the density image was rendered for
+    fTexCoord = vPos * 0.5 + 0.5;
+    gl_Position = uProjection * vec4(mix(uBounds.xz, uBounds.yw, fTexCoord), 0, 1);
+}
+)";
\ No newline at end of file
@@ -0,0 +1,38 @@
+// This is a header file serving only to hold GLSL code.
+// NOTE: The #version directive is automatically inserted at runtime according to user's GLSL version.
+const char* GRID_FRAGMENT_GLSL = R"(
+#if __VERSION__ >= 130
+    #define varying in
+    out vec4 color;
+#else
+    #define color gl_FragColor
+#endif
+
+varying vec2 fWorld;
+
+uniform vec2 uGridSpace;  // World units between minor lines
+uniform vec2 uGridMajor;  // Minor lines per major line
+uniform vec2 uPixelSize;  // World units per pixel
+uniform vec3 uAlpha;      // Minor, major and axis alpha
+
+// Fraction of this pixel covered by a line of the given half width, in pixels
+vec2 coverage(vec2 dist, float halfWidth) {
+    return clamp(halfWidth + 0.5 - dist, 0.0, 1.0);
+}
+
+void main() {
+    // Pixel distance to the nearest grid line in each direction
+    vec2 cell = fWorld / uGridSpace;
+    vec2 nearest = floor(cell + 0.5);
+    vec2 lineDist = abs(cell - nearest) * uGridSpace / uPixelSize;
+
+    // Every uGridMajor-th line is a major line
+    vec2 isMajor = step(abs(nearest - uGridMajor * floor(nearest / uGridMajor + 0.5)), vec2(0.5));
+    vec2 lineAlpha = mix(vec2(uAlpha.x), vec2(uAlpha.y), isMajor) * coverage(lineDist, 0.5);
+
+    // Axes are twice as wide and drawn on top
+    vec2 axisAlpha = uAlpha.z * coverage(abs(fWorld) / uPixelSize, 1.0);
+
+    color = vec4(1, 1, 1, max(max(lineAlpha.x, lineAlpha.y), max(axisAlpha.x, axisAlpha.y)));
+}
+)";
\ No newline at end of file
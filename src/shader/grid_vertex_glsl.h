@@ -0,0 +1,21 @@
+// This is a header file serving only to hold GLSL code.
+// NOTE: The #version directive is automatically inserted at runtime according to user's GLSL version.
+const char* GRID_VERTEX_GLSL = R"(
+#if __VERSION__ >= 130
+    #define attribute in
+    #define varying out
+#endif
+
+attribute vec2 vPos;
+
+uniform vec2 uViewMin;
+uniform vec2 uViewMax;
+
+varying vec2 fWorld;
+
+void main() {
+    // The quad covers the whole viewport, so clip space maps directly onto the visible area
+    fWorld = mix(uViewMin, uViewMax, vPos * 0.5 + 0.5);
+    gl_Position = vec4(vPos, 0, 1);
+}
+)";
\ No newline at end of file
@@ -0,0 +1,87 @@
+// This is a header file serving only to hold GLSL code.
+// NOTE: The #version directive is automatically inserted at runtime according to user's GLSL version.
+// The definition of equation() is appended at runtime, translated from the equation being drawn. REGION is defined for
+// inequalities, which also shade where the value is negative.
+const char* IMPLICIT_FRAGMENT_GLSL = R"(
+#ifdef GL_ES
+    precision highp float;
+#endif
+#if __VERSION__ >= 130
+    #define varying in
+    out vec4 color;
+#else
+    #define color gl_FragColor
+#endif
+
+varying vec2 fWorld;
+
+uniform vec2 uPixelSize;   // World units per pixel
+uniform vec4 uColor;
+uniform float uLineWidth;  // Pixels
+uniform float uFillAlpha;  // Opacity of the region relative to its boundary
+
+// Functions GLSL lacks, defined as on the CPU
+float sec(float v) { return 1.0 / cos(v); }
+float csc(float v) { return 1.0 / sin(v); }
+float cot(float v) { return 1.0 / tan(v); }
+float log10(float v) { return log(v) * 0.4342944819; }
+#if __VERSION__ < 130
+float sinh(float v) { return 0.5 * (exp(v) - exp(-v)); }
+float cosh(float v) { return 0.5 * (exp(v) + exp(-v)); }
+float tanh(float v) { return sinh(v) / cosh(v); }
+#endif
+
+// Integer powers of negative numbers are real, which pow() leaves undefined
+float power(float base, float exponent) {
+    if (base >= 0.0 || exponent != floor(exponent)) return pow(base, exponent);
+    float magnitude = pow(-base, exponent);
+    return mod(exponent, 2.0) == 1.0 ? -magnitude : magnitude;
+}
+
+// Odd roots of negative numbers are real
+float root(float index, float radicand) {
+    if (index == 2.0) return sqrt(radicand);
+    if (radicand < 0.0 && mod(index, 2.0) == 1.0) return -pow(-radicand, 1.0 / index);
+    return pow(radicand, 1.0 / index);
+}
+
+float equation(float x, float y);
+
+void main() {
+    float value = equation(fWorld.x, fWorld.y);
+
+    // Change of the value per pixel, so the distance to the curve can be estimated to first order
+    vec2 gradient = vec2(dFdx(value), dFdy(value));
+    vec2 toCurve = -value * gradient / dot(gradient, gradient);
+    float dist = length(toCurve);
+    float alpha = clamp(0.5 * uLineWidth + 0.5 - dist, 0.0, 1.0);
+
+    // Where the value jumps across zero instead, e.g. at a pole, the estimate means nothing. A real zero is much closer
+    // to the estimate than this pixel is, and the value changes smoothly on the way there
+    if (alpha > 0.0) {
+        vec2 estimate = fWorld + toCurve * uPixelSize;
+        vec2 halfway = fWorld + 0.5 * toCurve * uPixelSize;
+        float atEstimate = equation(estimate.x, estimate.y);
+        float atHalfway = equation(halfway.x, halfway.y);
+        if (!(abs(atEstimate) <= 0.25 * abs(value))) alpha = 0.0;
+        if (!(abs(atHalfway - 0.5 * (value + atEstimate)) <= 0.25 * abs(value - atEstimate))) alpha = 0.0;
+    }
+    if (!(alpha > 0.0)) alpha = 0.0;
+
+#ifdef REGION
+    // Covered where the value is negative, fading over the pixel the boundary crosses. Without a usable distance, e.g.
+    // where the value is flat, each pixel is simply in or out
+    float inside = value < 0.0 ? 1.0 : 0.0;
+    if (dist < 0.5) inside = value < 0.0 ? 0.5 + dist : 0.5 - dist;
+
+    // The boundary over the region, as when both are drawn from geometry
+    float curve = uColor.a * alpha;
+    float opacity = curve + uColor.a * uFillAlpha * inside * (1.0 - curve);
+    if (!(opacity > 0.0)) discard;
+    color = vec4(uColor.rgb, opacity);
+#else
+    if (!(alpha > 0.0)) discard;
+    color = vec4(uColor.rgb, uColor.a * alpha);
+#endif
+}
+)";
\ No newline at end of file
@@ -0,0 +1,28 @@
+// This is a header file serving only to hold GLSL code.
+// NOTE: The #version directive is automatically inserted at runtime according to user's GLSL version.
+const char* LINE_FRAGMENT_GLSL = R"(
+#if __VERSION__ >= 130
+    #define varying in
+    out vec4 color;
+#else
+    #define color gl_FragColor
+#endif
+
+varying vec2 fPos;
+varying float fLength;
+varying vec2 fJoints;
+
+uniform vec4 uColor;
+uniform float uLineWidth;
+
+void main() {
+    if (fJoints.x < 0.0 || fJoints.y < 0.0) discard;
+
+    // Pixel distance to the segment, which gives round caps and joins
+    float dist = length(vec2(fPos.x - clamp(fPos.x, 0.0, fLength), fPos.y));
+    float coverage = clamp(0.5 * uLineWidth + 0.5 - dist, 0.0, 1.0);
+    if (coverage <= 0.0) discard;
+
+    color = vec4(uColor.rgb, uColor.a * coverage);
+}
+)";
\ No newline at end of file
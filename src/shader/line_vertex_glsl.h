@@ -0,0 +1,61 @@
+// This is a header file serving only to hold GLSL code.
+// NOTE: The #version directive is automatically inserted at runtime according to user's GLSL version.
+const char* LINE_VERTEX_GLSL = R"(
+#if __VERSION__ >= 130
+    #define attribute in
+    #define varying out
+#endif
+
+attribute vec2 vCorner; // Corner of the quad: x runs from start (0) to end (1), y is the side (-1 or 1)
+attribute vec2 vStart;  // Segment endpoints, one pair per instance
+attribute vec2 vEnd;
+attribute vec2 vPrevStart; // Endpoints of the segments before and after, which continue it if they share an endpoint
+attribute vec2 vPrevEnd;
+attribute vec2 vNextStart;
+attribute vec2 vNextEnd;
+
+uniform mat4 uProjection;
+uniform vec2 uViewport;   // Viewport size in pixels
+uniform float uLineWidth; // Line width in pixels
+
+varying vec2 fPos;     // Position relative to the segment start, in pixels along and across the segment
+varying float fLength; // Segment length in pixels
+varying vec2 fJoints;  // Distances inside the joints with the segments before and after, negative where they draw
+
+vec2 toPixels(vec2 p) {
+    // The projection is orthographic, so w is always 1
+    return ((uProjection * vec4(p, 0, 1)).xy * 0.5 + 0.5) * uViewport;
+}
+
+// Direction across the line splitting the pixels around the joint of two segments, the bisector of their angle.
+// Both segments compute it from the same points, so each pixel is drawn by exactly one of them. Zero if they are
+// not joined, or turn too sharply for the line to stay within their quads, so both draw a whole round cap
+vec2 jointNormal(vec2 a, vec2 joint, vec2 b, bool joined) {
+    vec2 incoming = joint - a, outgoing = b - joint;
+    if (!joined || length(incoming) < 0.0001 || length(outgoing) < 0.0001) return vec2(0);
+    incoming = normalize(incoming);
+    outgoing = normalize(outgoing);
+    return dot(incoming, outgoing) > 0.0 ? normalize(incoming + outgoing) : vec2(0);
+}
+
+void main() {
+    vec2 start = toPixels(vStart);
+    vec2 end = toPixels(vEnd);
+
+    fLength = length(end - start);
+    vec2 dir = fLength > 0.0001 ? (end - start) / fLength : vec2(1, 0);
+    vec2 normal = vec2(-dir.y, dir.x);
+
+    // Extrude by half the width plus a pixel for the anti-aliased edge, including past both ends for the caps
+    float extent = 0.5 * uLineWidth + 1.0;
+    fPos = vec2(mix(-extent, fLength + extent, vCorner.x), vCorner.y * extent);
+
+    vec2 pixel = start + dir * fPos.x + normal * fPos.y;
+    gl_Position = vec4(pixel / uViewport * 2.0 - 1.0, 0, 1);
+
+    // Where a curve continues, each side of a joint is left to one segment, so translucent curves are not darker there
+    vec2 before = jointNormal(toPixels(vPrevStart), start, end, vPrevEnd == vStart);
+    vec2 after = jointNormal(start, end, toPixels(vNextEnd), vNextStart == vEnd);
+    fJoints = vec2(dot(pixel - start, before), dot(end - pixel, after));
+}
+)";
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QThread>
+#include <QTextStream>
+
+#include "core/graph_file.h"
+#include "equations/equation.h"
+#include "tiles/tile_server.h"
+
+
+// Serves graph files as map tiles to local dashboards
+int main(int argc, char* argv[]) {
+    // QPainter needs a GUI application, but never a display
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("Cubiq");
+    QCoreApplication::setApplicationName("Grapher Tiles");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Serves graph files as PNG tiles at /{graph}/{z}/{x}/{y}.png, and statistics at /stats");
+    parser.addHelpOption();
+    parser.addPositionalArgument("inputs", "Graph files, or directories of them", "<inputs...>");
+    parser.addOptions({
+            {{"p", "port"}, "Local TCP port to listen on", "port", "8080"},
+            {"socket", "Unix socket to listen on instead of a TCP port", "path"},
+            {"cache-mb", "Memory for cached tiles, in megabytes", "megabytes", "256"},
+            {{"j", "threads"}, "Number of tiles to render at once", "count", QString::number(QThread::idealThreadCount())},
+            {"sample-width", "Pixels between samples, as in the view's quality setting", "pixels", "1"},
+    });
+    parser.process(app);
+
+    QTextStream err(stderr);
+    auto fail = [&err](const QString& message) {
+        err << message << Qt::endl;
+        return 2;
+    };
+
+    bool ok;
+    const quint16 port = parser.value("port").toUShort(&ok);
+    if (!ok) return fail("Invalid port: " + parser.value("port"));
+    const qint64 cacheMegabytes = parser.value("cache-mb").toLongLong(&ok);
+    if (!ok || cacheMegabytes < 0) return fail("Invalid cache size: " + parser.value("cache-mb"));
+    const int threads = parser.value("threads").toInt(&ok);
+    if (!ok || threads <= 0) return fail("Invalid thread count: " + parser.value("threads"));
+    const double sampleWidth = parser.value("sample-width").toDouble(&ok);
+    if (!ok || sampleWidth <= 0) return fail("Invalid sample width: " + parser.value("sample-width"));
+
+    // Tiles are already rendered in parallel, so each is calculated on its own thread rather than oversubscribing
+    // the cores
+    Cubiq::Equation::setNumThreads(1);
+
+    Cubiq::TileServer server(cacheMegabytes * 1024 * 1024, threads, sampleWidth);
+    for (const QString& path: Cubiq::findGraphFiles(parser.positionalArguments())) {
+        QString error;
+        if (!server.addGraph(path, error)) err << path << ": " << error << Qt::endl;
+    }
+    if (server.getNumGraphs() == 0) return fail("No graphs to serve");
+
+    QString error;
+    const bool listening = parser.isSet("socket") ? server.listenLocal(parser.value("socket"), error)
+                                                  : server.listen(port, error);
+    if (!listening) return fail(error);
+
+    err << "Serving " << server.getNumGraphs() << " graphs on "
+        << (parser.isSet("socket") ? parser.value("socket") : "localhost:" + QString::number(port)) << Qt::endl;
+    return QGuiApplication::exec();
+}
\ No newline at end of file
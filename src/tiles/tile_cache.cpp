@@ -0,0 +1,57 @@
+#include "tile_cache.h"
+
+
+namespace Cubiq {
+
+    TileCache::TileCache(qint64 budget) : budget(budget), bytes(0), evictions(0) {}
+
+    bool TileCache::find(const std::string& key, QByteArray& tile) {
+        auto it = index.find(key);
+        if (it == index.end()) return false;
+
+        entries.splice(entries.begin(), entries, it->second);
+        tile = it->second->second;
+        return true;
+    }
+
+    void TileCache::insert(const std::string& key, QByteArray tile) {
+        // Tiles larger than the whole budget are not kept at all
+        if (tile.size() > budget) return;
+
+        auto it = index.find(key);
+        if (it != index.end()) {
+            bytes -= it->second->second.size();
+            entries.erase(it->second);
+            index.erase(it);
+        }
+
+        bytes += tile.size();
+        entries.emplace_front(key, std::move(tile));
+        index[key] = entries.begin();
+
+        while (bytes > budget) {
+            bytes -= entries.back().second.size();
+            index.erase(entries.back().first);
+            entries.pop_back();
+            evictions++;
+        }
+    }
+
+
+    qint64 TileCache::getBytes() const {
+        return bytes;
+    }
+
+    qint64 TileCache::getBudget() const {
+        return budget;
+    }
+
+    unsigned long TileCache::getNumTiles() const {
+        return entries.size();
+    }
+
+    unsigned long TileCache::getNumEvictions() const {
+        return evictions;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <list>
+#include <string>
+#include <utility>
+#include <unordered_map>
+#include <QByteArray>
+
+
+namespace Cubiq {
+
+    // Encoded tiles by key, evicting the least recently used once the total size exceeds the budget. Only used from
+    // the server's thread, so it is not synchronized
+    class TileCache {
+
+    public:
+        explicit TileCache(qint64 budget);
+
+        // Marks the tile as most recently used if found
+        bool find(const std::string& key, QByteArray& tile);
+        void insert(const std::string& key, QByteArray tile);
+
+        qint64 getBytes() const;
+        qint64 getBudget() const;
+        unsigned long getNumTiles() const;
+        unsigned long getNumEvictions() const;
+
+    private:
+        using Entry = std::pair<std::string, QByteArray>;
+
+        qint64 budget, bytes;
+        unsigned long evictions;
+
+        std::list<Entry> entries; // Most recently used first
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+
+    };
+
+}
\ No newline at end of file
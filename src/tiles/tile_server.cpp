@@ -0,0 +1,334 @@
+#include "tile_server.h"
+
+#include <cmath>
+#include <algorithm>
+#include <ctime>
+#include <optional>
+#include <QBuffer>
+#include <QFileInfo>
+#include <QTcpSocket>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "core/graph_file.h"
+
+
+namespace Cubiq {
+
+    const int TileServer::TILE_SIZE = 256; // Pixels
+    const double TileServer::TILE_UNITS = 256; // Graph units covered by a tile at zoom 0
+    const int TileServer::MAX_ZOOM = 20; // Pixels of 8 float ulps at a unit from the origin
+    const int TileServer::MIN_ULPS_PER_PIXEL = 8; // Float spacing a pixel spans at least, anywhere in a tile
+    const int TileServer::MAX_REQUEST_BYTES = 8192; // Request line and headers
+
+    namespace {
+
+        QByteArray reasonPhrase(int status) {
+            switch (status) {
+                case 200: return "OK";
+                case 400: return "Bad Request";
+                case 404: return "Not Found";
+                case 405: return "Method Not Allowed";
+                case 431: return "Request Header Fields Too Large";
+                default: return "Internal Server Error";
+            }
+        }
+
+        // Graph area of a tile, or nothing if it is so far from the origin for its zoom that single precision cannot
+        // resolve its pixels
+        std::optional<BoundingBox> tileBounds(int z, qint64 x, qint64 y) {
+            const double size = TileServer::TILE_UNITS / std::ldexp(1.0, z);
+            const BoundingBox bounds{(float) ((double) x * size), (float) ((double) (x + 1) * size),
+                                     (float) ((double) -(y + 1) * size), (float) ((double) -y * size)};
+
+            // Floats within the tile are no farther apart than at its farthest corner. Infinite bounds fail as well
+            const float extent = std::max({std::abs(bounds.minX), std::abs(bounds.maxX), std::abs(bounds.minY),
+                                           std::abs(bounds.maxY)});
+            const double spacing = std::nextafter(extent, INFINITY) - extent;
+            if (!(spacing <= size / TileServer::TILE_SIZE / TileServer::MIN_ULPS_PER_PIXEL)) return {};
+            return bounds;
+        }
+
+        // CPU time of the calling thread, which is all of a tile's, as each is calculated on the thread rendering it
+        double threadCpuMillis() {
+            timespec time{};
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+            return (double) time.tv_sec * 1e3 + (double) time.tv_nsec / 1e6;
+        }
+
+        // Either kind of socket, once everything written has been sent
+        void closeSocket(QIODevice* socket) {
+            if (auto* tcpSocket = qobject_cast<QAbstractSocket*>(socket)) tcpSocket->disconnectFromHost();
+            if (auto* localSocket = qobject_cast<QLocalSocket*>(socket)) localSocket->disconnectFromServer();
+        }
+
+    }
+
+
+    TileServer::TileServer(qint64 cacheBudget, int numThreads, double sampleWidth, QObject* parent) :
+            QObject(parent), renderer(TILE_SIZE, TILE_SIZE, sampleWidth), cache(cacheBudget) {
+        pool.setMaxThreadCount(numThreads);
+        uptime.start();
+
+        connect(&tcpServer, &QTcpServer::newConnection, this, [this]() {
+            while (QTcpSocket* socket = tcpServer.nextPendingConnection()) {
+                connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+                addConnection(socket);
+            }
+        });
+        connect(&localServer, &QLocalServer::newConnection, this, [this]() {
+            while (QLocalSocket* socket = localServer.nextPendingConnection()) {
+                connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+                addConnection(socket);
+            }
+        });
+    }
+
+    TileServer::~TileServer() {
+        pool.waitForDone();
+    }
+
+
+    bool TileServer::addGraph(const QString& path, QString& error) {
+        Graph* graph = loadGraph(path, error);
+        if (!graph) return false;
+
+        graphs[QFileInfo(path).completeBaseName().toStdString()] = std::shared_ptr<Graph>(graph);
+        return true;
+    }
+
+    int TileServer::getNumGraphs() const {
+        return (int) graphs.size();
+    }
+
+    // Only on the loopback interface, since the server is meant for local services
+    bool TileServer::listen(quint16 port, QString& error) {
+        if (!tcpServer.listen(QHostAddress::LocalHost, port)) {
+            error = tcpServer.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    bool TileServer::listenLocal(const QString& name, QString& error) {
+        // A socket file left behind by a server that did not exit cleanly would prevent listening
+        QLocalServer::removeServer(name);
+        if (!localServer.listen(name)) {
+            error = localServer.errorString();
+            return false;
+        }
+        return true;
+    }
+
+
+    void TileServer::addConnection(QIODevice* socket) {
+        connections[socket] = Connection();
+        connect(socket, &QObject::destroyed, this, [this, socket]() { connections.erase(socket); });
+        connect(socket, &QIODevice::readyRead, this, [this, socket]() {
+            auto it = connections.find(socket);
+            if (it == connections.end()) return;
+            it->second.buffer += socket->readAll();
+            processRequests(socket);
+        });
+    }
+
+    // Handles the complete requests received so far, one at a time
+    void TileServer::processRequests(QIODevice* socket) {
+        auto it = connections.find(socket);
+        if (it == connections.end()) return;
+        Connection& connection = it->second;
+
+        while (!connection.busy && connection.keepAlive) {
+            const int headerEnd = connection.buffer.indexOf("\r\n\r\n");
+            if (headerEnd < 0) {
+                if (connection.buffer.size() > MAX_REQUEST_BYTES) {
+                    connection.keepAlive = false;
+                    respond(socket, 431, "text/plain", "Request too large\n");
+                }
+                return;
+            }
+
+            const QList<QByteArray> lines = connection.buffer.left(headerEnd).split('\n');
+            connection.buffer.remove(0, headerEnd + 4);
+
+            const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+            if (requestLine.size() != 3) {
+                connection.keepAlive = false;
+                respond(socket, 400, "text/plain", "Malformed request\n");
+                return;
+            }
+
+            // HTTP/1.1 keeps connections open unless asked not to, and HTTP/1.0 only if asked to
+            connection.keepAlive = requestLine[2] != "HTTP/1.0";
+            for (int i = 1; i < lines.size(); i++) {
+                const int colon = lines[i].indexOf(':');
+                if (colon < 0 || lines[i].left(colon).trimmed().toLower() != "connection") continue;
+                const QByteArray value = lines[i].mid(colon + 1).trimmed().toLower();
+                if (value == "close") connection.keepAlive = false;
+                if (value == "keep-alive") connection.keepAlive = true;
+            }
+
+            handleRequest(socket, requestLine[0], requestLine[1]);
+        }
+    }
+
+    void TileServer::handleRequest(QIODevice* socket, const QByteArray& method, const QByteArray& target) {
+        stats.requests++;
+        if (method != "GET") {
+            respond(socket, 405, "text/plain", "Only GET is supported\n");
+            return;
+        }
+
+        const QByteArray path = target.left(target.indexOf('?'));
+        if (path == "/stats") {
+            respond(socket, 200, "application/json", statsJson());
+            return;
+        }
+
+        // /{graph}/{z}/{x}/{y}.png
+        QList<QByteArray> parts = path.split('/');
+        if (parts.size() != 5 || !parts[0].isEmpty() || !parts[4].endsWith(".png")) {
+            respond(socket, 404, "text/plain", "Not found\n");
+            return;
+        }
+        parts[4].chop(4);
+
+        bool zValid, xValid, yValid;
+        const int z = parts[2].toInt(&zValid);
+        const qint64 x = parts[3].toLongLong(&xValid);
+        const qint64 y = parts[4].toLongLong(&yValid);
+        if (!zValid || !xValid || !yValid || z < 0 || z > MAX_ZOOM || !tileBounds(z, x, y)) {
+            respond(socket, 400, "text/plain", "Invalid tile coordinates\n");
+            return;
+        }
+
+        const std::string graphName = QByteArray::fromPercentEncoding(parts[1]).toStdString();
+        if (graphs.find(graphName) == graphs.end()) {
+            respond(socket, 404, "text/plain", "Unknown graph\n");
+            return;
+        }
+
+        requestTile(socket, graphName, z, x, y);
+    }
+
+    void TileServer::requestTile(QIODevice* socket, const std::string& graphName, int z, qint64 x, qint64 y) {
+        stats.tileRequests++;
+
+        const std::string key = graphName + "/" + std::to_string(z) + "/" + std::to_string(x) + "/" + std::to_string(y);
+        QByteArray tile;
+        if (cache.find(key, tile)) {
+            stats.cacheHits++;
+            respond(socket, 200, "image/png", tile);
+            return;
+        }
+
+        connections.at(socket).busy = true;
+        auto it = inFlight.find(key);
+        if (it != inFlight.end()) {
+            stats.coalesced++;
+            it->second.emplace_back(socket);
+            return;
+        }
+        inFlight[key].emplace_back(socket);
+
+        const BoundingBox bounds = *tileBounds(z, x, y);
+        std::shared_ptr<Graph> graph = graphs.at(graphName);
+
+        // The server waits for the pool before it is destroyed, so it outlives every task
+        pool.start([this, key, graph, bounds]() {
+            QElapsedTimer timer;
+            timer.start();
+            const double cpuStart = threadCpuMillis();
+
+            const QImage image = renderer.renderImage(*graph, bounds);
+            QByteArray png;
+            QBuffer buffer(&png);
+            buffer.open(QIODevice::WriteOnly);
+            if (!image.save(&buffer, "PNG")) png.clear();
+
+            const double millis = (double) timer.nsecsElapsed() / 1e6;
+            const double cpuMillis = threadCpuMillis() - cpuStart;
+            QMetaObject::invokeMethod(this, [this, key, png, millis, cpuMillis]() {
+                finishTile(key, png, millis, cpuMillis);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    void TileServer::finishTile(const std::string& key, const QByteArray& tile, double millis, double cpuMillis) {
+        stats.rendered++;
+        stats.renderMillis += millis;
+        stats.cpuMillis += cpuMillis;
+
+        // Taken out first, since answering a waiting connection can start its next request
+        std::vector<QPointer<QIODevice>> waiting;
+        auto it = inFlight.find(key);
+        if (it != inFlight.end()) {
+            waiting = std::move(it->second);
+            inFlight.erase(it);
+        }
+        if (!tile.isEmpty()) cache.insert(key, tile);
+
+        for (const QPointer<QIODevice>& socket: waiting) {
+            if (!socket) continue;
+            auto connection = connections.find(socket.data());
+            if (connection == connections.end()) continue;
+
+            connection->second.busy = false;
+            if (tile.isEmpty()) {
+                respond(socket, 500, "text/plain", "Could not encode tile\n");
+            } else {
+                respond(socket, 200, "image/png", tile);
+            }
+            processRequests(socket);
+        }
+    }
+
+    QByteArray TileServer::statsJson() const {
+        const double uptimeSeconds = (double) uptime.elapsed() / 1000;
+        const double renderSeconds = stats.renderMillis / 1000;
+        const double cpuSeconds = stats.cpuMillis / 1000;
+
+        QJsonObject cacheStats{
+                {"tiles", (qint64) cache.getNumTiles()},
+                {"bytes", cache.getBytes()},
+                {"budget", cache.getBudget()},
+                {"evictions", (qint64) cache.getNumEvictions()},
+        };
+
+        QJsonObject json{
+                {"graphs", (int) graphs.size()},
+                {"threads", pool.maxThreadCount()},
+                {"uptimeSeconds", uptimeSeconds},
+                {"requests", (qint64) stats.requests},
+                {"tileRequests", (qint64) stats.tileRequests},
+                {"cacheHits", (qint64) stats.cacheHits},
+                {"coalesced", (qint64) stats.coalesced},
+                {"inFlight", (qint64) inFlight.size()},
+                {"rendered", (qint64) stats.rendered},
+                {"renderSeconds", renderSeconds},
+                {"cpuSeconds", cpuSeconds},
+                {"tilesPerSecond", uptimeSeconds > 0 ? (double) stats.rendered / uptimeSeconds : 0.0},
+                // From CPU time rather than render time, which also counts time spent waiting for a core
+                {"tilesPerSecondPerCore", cpuSeconds > 0 ? (double) stats.rendered / cpuSeconds : 0.0},
+                {"cache", cacheStats},
+        };
+        return QJsonDocument(json).toJson(QJsonDocument::Compact);
+    }
+
+
+    void TileServer::respond(QIODevice* socket, int status, const QByteArray& type, const QByteArray& body) {
+        auto it = connections.find(socket);
+        const bool keepAlive = it != connections.end() && it->second.keepAlive;
+
+        QByteArray header = "HTTP/1.1 " + QByteArray::number(status) + " " + reasonPhrase(status) + "\r\n";
+        header += "Content-Type: " + type + "\r\n";
+        header += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+        header += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        socket->write(header);
+        socket->write(body);
+
+        if (!keepAlive) closeSocket(socket);
+    }
+
+}
\ No newline at end of file
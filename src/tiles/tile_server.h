@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <QObject>
+#include <QPointer>
+#include <QTcpServer>
+#include <QLocalServer>
+#include <QThreadPool>
+#include <QElapsedTimer>
+
+#include "core/graph.h"
+#include "render/figure_renderer.h"
+#include "tiles/tile_cache.h"
+
+
+namespace Cubiq {
+
+    // Serves graphs as map-style PNG tiles over HTTP, on a local TCP port or a Unix socket:
+    //   GET /{graph}/{z}/{x}/{y}.png  Tile x, y at zoom z of the graph loaded from {graph}.json
+    //   GET /stats                    Counters and throughput as JSON
+    // A tile at zoom z is TILE_UNITS / 2^z graph units wide, with x to the right and y downwards from the origin, so
+    // negative x and y are valid. Zoom stops where tiles away from the origin could no longer be told apart in single
+    // precision, and tiles too far out for their zoom are rejected. Tiles are rendered on a thread pool and cached. Requests for a tile that is already
+    // being rendered wait for it instead of rendering it again
+    class TileServer : public QObject {
+    Q_OBJECT
+
+    public:
+        static const int TILE_SIZE;
+        static const double TILE_UNITS;
+        static const int MAX_ZOOM;
+        static const int MIN_ULPS_PER_PIXEL;
+        static const int MAX_REQUEST_BYTES;
+
+        TileServer(qint64 cacheBudget, int numThreads, double sampleWidth, QObject* parent = nullptr);
+        ~TileServer() override; // Waits for tiles still being rendered
+
+        // Loads a graph file to serve under its base name
+        bool addGraph(const QString& path, QString& error);
+        int getNumGraphs() const;
+
+        bool listen(quint16 port, QString& error);
+        bool listenLocal(const QString& name, QString& error);
+
+    private:
+        struct Connection {
+            QByteArray buffer;
+            bool busy = false;      // Waiting for a tile, so later requests are held back to keep responses in order
+            bool keepAlive = true;
+        };
+
+        struct Stats {
+            unsigned long requests = 0;
+            unsigned long tileRequests = 0;
+            unsigned long cacheHits = 0;
+            unsigned long coalesced = 0; // Requests that waited for a tile already being rendered
+            unsigned long rendered = 0;
+            double renderMillis = 0;     // Summed over all threads
+            double cpuMillis = 0;        // CPU time of the rendering threads, likewise
+        };
+
+        QTcpServer tcpServer;
+        QLocalServer localServer;
+        QThreadPool pool;
+
+        FigureRenderer renderer;
+        TileCache cache;
+        std::unordered_map<std::string, std::shared_ptr<Graph>> graphs;
+
+        std::unordered_map<QIODevice*, Connection> connections;
+        std::unordered_map<std::string, std::vector<QPointer<QIODevice>>> inFlight;
+
+        Stats stats;
+        QElapsedTimer uptime;
+
+        void addConnection(QIODevice* socket);
+        void processRequests(QIODevice* socket);
+        void handleRequest(QIODevice* socket, const QByteArray& method, const QByteArray& target);
+        void requestTile(QIODevice* socket, const std::string& graphName, int z, qint64 x, qint64 y);
+        void finishTile(const std::string& key, const QByteArray& tile, double millis, double cpuMillis);
+        QByteArray statsJson() const;
+
+        void respond(QIODevice* socket, int status, const QByteArray& type, const QByteArray& body);
+
+    };
+
+}
\ No newline at end of file